@@ -0,0 +1,513 @@
+/**
+ * @file bench.cpp
+ * @author Steven
+ * @brief Benchmark of the VOW walk: raw compression throughput of every SHA-2 variant on every selected device and host kernel, walk step throughput over a grid of walker counts and batch lengths, the host stage 2, and end-to-end collisions for small N against the expected VOW work, written as JSON lines
+ * @version 0.1
+ * @date 2026-02-12
+ *
+ * Every measurement is taken after an untimed warm-up run (JIT compilation, first-touch allocations)
+ * and repeated with twice the work until it lasts --min-time, so short runs stay meaningful on fast devices.
+ * One JSON object per line, comparable between builds with any line-oriented tool.
+ */
+
+#include <sycl/sycl.hpp>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include "config.hpp"
+#include "telemetry.hpp"
+#include "launch.hpp"
+#include "stage_two.hpp"
+#include "vow.hpp"
+
+constexpr std::size_t BENCH_N = 8;                  // Collision length of the compress and step benchmarks
+constexpr std::size_t MAX_DOUBLINGS = 20;           // Bound on the work doublings of one measurement
+constexpr std::size_t STAGE_TWO_TRAIL = 1 << 14;    // Trail length the stage2 suite starts doubling from
+
+/**
+ * @brief what to measure, parsed from the command line
+ */
+struct BenchConfig {
+    std::string devices = "default";            // --devices: SYCL devices as for the campaign (`host`: the host kernels only)
+    HASH_TYPE hash_type = HASH_TYPE::SHA256;    // --hash: hash function of the step and collide suites (compress covers all six)
+    std::vector<std::string> suites = {"compress", "step", "stage2", "collide"};     // --suites: suites to run
+    std::size_t min_time = 500;                 // --min-time: milliseconds a measurement must last at least
+    std::size_t compress_threads = 65536;       // --compress-threads: walkers of the device compression kernel
+    std::vector<std::size_t> threads = {4096, 20'000, 65536};         // --threads: walker counts of the step grid
+    std::vector<std::size_t> batch_size = {1000, 10'000, 100'000};    // --batch-size: batch lengths of the step grid
+    std::vector<std::size_t> n = {3, 4, 5, 6};  // --n: collision lengths of the collide suite (from SUPPORTED_N)
+    std::size_t runs = 3;                       // --runs: collisions per length, each with its own prefix
+    std::size_t collide_threads = 256;          // --collide-threads: walkers per device of the collide suite
+    std::size_t collide_batch_size = 1000;      // --collide-batch-size: batch length of the collide suite
+    std::string out;                            // --out: file the JSON lines are appended to (empty: stdout)
+
+    bool runs_suite(std::string_view suite) const noexcept {
+        return std::find(suites.begin(), suites.end(), suite) != suites.end();
+    }
+};
+
+void print_bench_usage(std::ostream &os, std::string_view program) {
+    const BenchConfig defaults;
+    os << "Usage: " << program << " [options]\n"
+        << "  --devices SPEC          SYCL devices as for sha2_collision, or host for the host kernels only (default " << defaults.devices << ")\n"
+        << "  --hash NAME             hash function of the step and collide suites (default " << hash_name(defaults.hash_type) << ")\n"
+        << "  --suites LIST           comma-separated: compress, step, stage2, collide (default all)\n"
+        << "  --min-time MS           milliseconds every measurement lasts at least (default " << defaults.min_time << ")\n"
+        << "  --compress-threads COUNT  walkers of the device compression kernel (default " << defaults.compress_threads << ")\n"
+        << "  --threads COUNT[,...]   walker counts of the step grid (default 4096,20000,65536)\n"
+        << "  --batch-size STEPS[,...] batch lengths of the step grid (default 1000,10000,100000)\n"
+        << "  --n BYTES[,...]         collision lengths of the collide suite (default 3,4,5,6)\n"
+        << "  --runs COUNT            collisions per length (default " << defaults.runs << ")\n"
+        << "  --collide-threads COUNT walkers per device of the collide suite (default " << defaults.collide_threads << ")\n"
+        << "  --collide-batch-size STEPS  batch length of the collide suite (default " << defaults.collide_batch_size << ")\n"
+        << "  --out FILE              append the JSON lines to FILE instead of stdout\n"
+        << "  --help                  print this message\n";
+}
+
+std::optional<BenchConfig> parse_bench_args(int argc, char **argv, std::ostream &err) {
+    BenchConfig config;
+    const std::string_view program = argc > 0 ? argv[0] : "bench";
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == "--help") {
+            print_bench_usage(err, program);
+            return std::nullopt;
+        }
+        if (i + 1 >= argc) {
+            err << "Missing value for " << option << "\n";
+            print_bench_usage(err, program);
+            return std::nullopt;
+        }
+        const std::string_view value = argv[++i];
+        bool ok = true;
+        if (option == "--devices") {
+            config.devices = value;
+        } else if (option == "--hash") {
+            ok = false;
+            for (const auto &[name, type] : HASH_NAMES) {
+                if (value == name) {
+                    config.hash_type = type;
+                    ok = true;
+                }
+            }
+        } else if (option == "--suites") {
+            config.suites.clear();
+            for (std::string_view rest = value; ok; ) {
+                const auto comma = rest.find(',');
+                const auto suite = rest.substr(0, comma);
+                ok = suite == "compress" || suite == "step" || suite == "stage2" || suite == "collide";
+                config.suites.emplace_back(suite);
+                if (comma == std::string_view::npos) {
+                    break;
+                }
+                rest.remove_prefix(comma + 1);
+            }
+        } else if (option == "--min-time") {
+            ok = parse_size(value, config.min_time) && config.min_time > 0;
+        } else if (option == "--compress-threads") {
+            ok = parse_size(value, config.compress_threads) && config.compress_threads > 0 && config.compress_threads % LANES == 0;
+        } else if (option == "--threads") {
+            ok = parse_sizes(value, config.threads)
+                && std::all_of(config.threads.begin(), config.threads.end(), [] (std::size_t t) { return t % LANES == 0; });
+        } else if (option == "--batch-size") {
+            ok = parse_sizes(value, config.batch_size);
+        } else if (option == "--n") {
+            ok = parse_sizes(value, config.n);
+        } else if (option == "--runs") {
+            ok = parse_size(value, config.runs) && config.runs > 0;
+        } else if (option == "--collide-threads") {
+            ok = parse_size(value, config.collide_threads) && config.collide_threads > 0 && config.collide_threads % LANES == 0;
+        } else if (option == "--collide-batch-size") {
+            ok = parse_size(value, config.collide_batch_size) && config.collide_batch_size > 0;
+        } else if (option == "--out") {
+            config.out = value;
+            ok = !value.empty();
+        } else {
+            err << "Unknown option " << option << "\n";
+            print_bench_usage(err, program);
+            return std::nullopt;
+        }
+        if (!ok) {
+            err << "Invalid value for " << option << ": " << value << "\n";
+            return std::nullopt;
+        }
+    }
+    return config;
+}
+
+
+/**
+ * @brief hashes computed in one timed run
+ */
+struct Measurement {
+    std::size_t hashes = 0;
+    double seconds = 0;
+    std::size_t repeat = 0;                 // work units (steps or batches) of the run
+
+    std::size_t rate() const noexcept {
+        return hash_rate(hashes, seconds);
+    }
+};
+
+/**
+ * @brief runs `run(1)` untimed, then `run(repeat)` with `repeat` doubling from `initial` until a run lasts `min_seconds`
+ * @param run               returns the hashes computed for a repeat count
+ */
+template <typename RUN>
+Measurement measure(RUN &&run, std::size_t initial, double min_seconds) {
+    (void) run(1);
+    Measurement measurement;
+    for (std::size_t repeat = initial, doublings = 0; ; repeat *= 2, ++doublings) {
+        const auto start = std::chrono::steady_clock::now();
+        measurement.hashes = run(repeat);
+        measurement.seconds = elapsed_seconds(start, std::chrono::steady_clock::now());
+        measurement.repeat = repeat;
+        if (measurement.seconds >= min_seconds || doublings == MAX_DOUBLINGS) {
+            return measurement;
+        }
+    }
+}
+
+/**
+ * @brief std::cout swallowed for the lifetime of the guard (the campaign functions report there)
+ */
+class QuietCout
+{
+
+public:
+
+    QuietCout(): saved{std::cout.rdbuf(nullptr)} {}
+
+    ~QuietCout() {
+        std::cout.rdbuf(saved);
+        std::cout.clear();
+    }
+
+    QuietCout(const QuietCout &) = delete;
+    QuietCout &operator=(const QuietCout &) = delete;
+
+private:
+
+    std::streambuf *saved;
+
+};
+
+/**
+ * @brief calls `f(std::type_identity<HASH>{})` with the hash function of `hash_type`
+ */
+template <typename F>
+void with_hash(HASH_TYPE hash_type, F &&f) {
+    switch (hash_type) {
+    case HASH_TYPE::SHA224:
+        return f(std::type_identity<SHA224>{});
+    case HASH_TYPE::SHA256:
+        return f(std::type_identity<SHA256>{});
+    case HASH_TYPE::SHA384:
+        return f(std::type_identity<SHA384>{});
+    case HASH_TYPE::SHA512:
+        return f(std::type_identity<SHA512>{});
+    case HASH_TYPE::SHA512_224:
+        return f(std::type_identity<SHA512_224>{});
+    case HASH_TYPE::SHA512_256:
+        return f(std::type_identity<SHA512_256>{});
+    }
+}
+
+
+template <typename HASH, bool PAIRED>
+class CompressKernel;
+
+/**
+ * @brief bare walk compressions of `threads` walkers on a device, without DP detection or state traffic
+ *
+ * @tparam PAIRED   computes 64-bit words as 32-bit pairs
+ */
+template <typename HASH, bool PAIRED = false>
+Measurement device_compress(sycl::queue &q, const Walk<HASH> &walk, std::size_t threads, double min_seconds) {
+    using word_t = typename HASH_WORDS<HASH>::value_type;
+    using CALC = std::conditional_t<PAIRED, Word64Pair, word_t>;
+    const auto midstate = walk.midstate;
+    word_t *sink = malloc_device<word_t>(threads / LANES, q);
+    const auto measurement = measure([&](std::size_t steps) {
+        q.submit([&](sycl::handler& h) {
+            set_walk_constants(h, walk);
+            h.parallel_for<CompressKernel<HASH, PAIRED>>(sycl::range<1>(threads / LANES), [=](sycl::id<1> item, sycl::kernel_handler kh) {
+                const auto walk = kernel_walk<HASH>(kh, midstate);
+                std::array<HASH_WORDS<HASH>, LANES> hash;
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    hash[l] = hash_to_words<HASH>(start_point<BENCH_N>(0, lane_walker(item, l, threads)));
+                }
+                for (std::size_t i = 0; i < steps; ++i) {
+                    hash = compress_message<HASH, LANES, CALC>(walk.message, walk.midstate, hash);
+                }
+                word_t folded = 0;
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    folded ^= hash[l][0];
+                }
+                sink[item] = folded;            // keeps the walk from being optimised away
+            });
+        }).wait();
+        return threads * steps;
+    }, 64, min_seconds);
+    sycl::free(sink, q);
+    return measurement;
+}
+
+/**
+ * @brief bare walk compressions of SIMD_MAX_LANES walkers per thread of `pool` with a host kernel
+ */
+template <typename HASH>
+Measurement host_compress(SIMD_BACKEND backend, const Walk<HASH> &walk, WorkerPool &pool, double min_seconds) {
+    using word_t = typename HASH_WORDS<HASH>::value_type;
+    std::vector<word_t> sink(pool.size());
+    return measure([&](std::size_t steps) {
+        pool.run([&](std::size_t t) {
+            std::array<HASH_WORDS<HASH>, SIMD_MAX_LANES> hash, next;
+            for (std::size_t l = 0; l < SIMD_MAX_LANES; ++l) {
+                hash[l] = hash_to_words<HASH>(start_point<BENCH_N>(0, t * SIMD_MAX_LANES + l));
+            }
+            for (std::size_t i = 0; i < steps; ++i) {
+                compress_lanes<HASH>(backend, walk.message, walk.midstate, hash.data(), next.data(), SIMD_MAX_LANES);
+                hash = next;
+            }
+            sink[t] = hash[0][0];
+        });
+        return pool.size() * SIMD_MAX_LANES * steps;
+    }, 4, min_seconds);
+}
+
+/**
+ * @brief the compress suite: every hash function on every device and every host kernel this CPU runs
+ */
+void bench_compress(const BenchConfig &bench, std::vector<sycl::queue> &queues, const std::vector<std::string> &names, std::ostream &out) {
+    const double min_seconds = static_cast<double>(bench.min_time) / 1000;
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (const auto &[hash, hash_type] : HASH_NAMES) {
+        with_hash(hash_type, [&, hash = hash] (auto tag) {
+            using HASH = typename decltype(tag)::type;
+            Config config;
+            config.n = BENCH_N;
+            const auto walk = make_walk<HASH>(config);
+            auto report = [&](const std::string &device, std::string_view kernel, std::size_t threads, const Measurement &m) {
+                JsonLine(out).add("bench", "compress").add("hash", hash).add("device", device).add("kernel", kernel).add("threads", threads)
+                    .add("steps", m.repeat).add("hashes", m.hashes).add("seconds", m.seconds).add("rate", m.rate());
+                std::cerr << "compress " << hash << " on " << device << " (" << kernel << "): " << m.rate() << " hashes per second" << std::endl;
+            };
+            for (std::size_t d = 0; d < queues.size(); ++d) {
+                report(names[d], "sycl", bench.compress_threads, device_compress<HASH>(queues[d], walk, bench.compress_threads, min_seconds));
+                if constexpr (sizeof(typename HASH_WORDS<HASH>::value_type) == 8) {
+                    report(names[d], "sycl-pairs", bench.compress_threads, device_compress<HASH, true>(queues[d], walk, bench.compress_threads, min_seconds));
+                }
+            }
+            for (const auto &[kernel, backend] : SIMD_BACKEND_NAMES) {
+                if (simd_supported(backend) && (backend != SIMD_BACKEND::SHA_NI || sizeof(typename HASH_WORDS<HASH>::value_type) == 4)) {
+                    report("host", kernel, pool.size() * SIMD_MAX_LANES, host_compress<HASH>(backend, walk, pool, min_seconds));
+                }
+            }
+        });
+    }
+}
+
+
+/**
+ * @brief batches of the stage-1 kernel (with DP detection, the trail cap and the state load and store) on a device
+ */
+template <typename HASH, std::size_t N>
+Measurement device_steps(sycl::queue &q, const Walk<HASH> &walk, std::size_t threads, std::size_t batch_size, std::size_t dp_buffer_len, double min_seconds) {
+    const auto states = StateBuffers<HASH, N>::allocate(q, threads);
+    const auto dps = DPBuffer<HASH, N>::allocate(q, dp_buffer_len);
+    submit_walk<HASH, N>(q, walk, states, dps, 0, 0, 0, {}, 0).wait();
+    const auto measurement = measure([&](std::size_t batches) {
+        for (std::size_t b = 0; b < batches; ++b) {
+            auto reset = q.memset(dps.cursor, 0, sizeof(uint32_t) * DPBuffer<HASH, N>::COUNTERS);
+            submit_walk<HASH, N>(q, walk, states, dps, batch_size, b * batch_size, 0, {reset}).wait();
+        }
+        return threads * batch_size * batches;
+    }, 1, min_seconds);
+    states.free(q);
+    dps.free(q);
+    return measurement;
+}
+
+/**
+ * @brief the step suite: the --threads x --batch-size grid of the stage-1 kernel of --hash on every device
+ */
+void bench_steps(const BenchConfig &bench, std::vector<sycl::queue> &queues, const std::vector<std::string> &names, std::ostream &out) {
+    const double min_seconds = static_cast<double>(bench.min_time) / 1000;
+    with_hash(bench.hash_type, [&] (auto tag) {
+        using HASH = WALK_HASH<typename decltype(tag)::type, BENCH_N>;
+        Config config;
+        config.n = BENCH_N;
+        const auto walk = make_walk<HASH>(config);
+        for (std::size_t d = 0; d < queues.size(); ++d) {
+            for (const auto threads : bench.threads) {
+                for (const auto batch_size : bench.batch_size) {
+                    const auto m = device_steps<HASH, BENCH_N>(queues[d], device_walk(walk, config, queues[d].get_device()), threads, batch_size, config.dp_buffer_len, min_seconds);
+                    JsonLine(out).add("bench", "step").add("hash", hash_name(bench.hash_type)).add("device", names[d]).add("n", BENCH_N).add("k", config.k)
+                        .add("threads", threads).add("batch_size", batch_size).add("batches", m.repeat)
+                        .add("hashes", m.hashes).add("seconds", m.seconds).add("rate", m.rate());
+                    std::cerr << "step " << hash_name(bench.hash_type) << " on " << names[d] << ", " << threads << " walkers x " << batch_size
+                        << " steps: " << m.rate() << " hashes per second" << std::endl;
+                }
+            }
+        }
+    });
+}
+
+
+/**
+ * @brief the stage2 suite: host stage 2 of --hash with the kernel it picks (chain_backend)
+ *
+ * It re-walks two trails of the same length that never merge, the worst case of a DP collision whose chains merge next to the DP.
+ * The trails double from STAGE_TWO_TRAIL steps until a run lasts --min-time.
+ */
+void bench_stage_two(const BenchConfig &bench, std::ostream &out) {
+    const double min_seconds = static_cast<double>(bench.min_time) / 1000;
+    std::ostream quiet(nullptr);
+    with_hash(bench.hash_type, [&] (auto tag) {
+        using HASH = WALK_HASH<typename decltype(tag)::type, BENCH_N>;
+        Config config;
+        config.hash_type = bench.hash_type;
+        config.n = BENCH_N;
+        const auto walk = make_walk<HASH>(config);
+        StageOneResult<HASH, BENCH_N> dp_collision;
+        dp_collision.x = start_point<BENCH_N>(walk.start_key, 1);
+        dp_collision.y = start_point<BENCH_N>(walk.start_key, 2);
+        dp_collision.found = true;
+        auto trails = [&](std::size_t repeat) {
+            dp_collision.x_steps = dp_collision.y_steps = repeat * STAGE_TWO_TRAIL;
+            return dp_collision;
+        };
+        auto report = [&](const std::string &device, std::string_view kernel, const Measurement &m) {
+            JsonLine(out).add("bench", "stage2").add("hash", hash_name(bench.hash_type)).add("device", device).add("kernel", kernel)
+                .add("trail_steps", m.repeat * STAGE_TWO_TRAIL).add("hashes", m.hashes).add("seconds", m.seconds).add("rate", m.rate());
+            std::cerr << "stage2 " << hash_name(bench.hash_type) << " on " << device << " (" << kernel << "), trails of " << m.repeat * STAGE_TWO_TRAIL 
+                << " steps: " << m.seconds << " seconds, " << m.rate() << " hashes per second" << std::endl;
+        };
+        report("host", simd_backend_name(chain_backend(sizeof(typename HASH_WORDS<HASH>::value_type), 2)), measure([&](std::size_t repeat) {
+            const auto [x_state, y_state] = vow_stage_two<HASH, BENCH_N>(config, walk, trails(repeat), quiet);
+            return x_state.hash_count + y_state.hash_count;
+        }, 1, min_seconds));
+    });
+}
+
+
+/**
+ * @brief --runs whole campaigns (stage 1 on all devices, then stage 2 on the host) for one N, each after an untimed warm-up run
+ */
+template <typename HASH, std::size_t N>
+void bench_collide_n(const BenchConfig &bench, std::vector<sycl::queue> &queues, std::ostream &out) {
+    std::ostream quiet(nullptr);
+    Config config;
+    config.hash_type = bench.hash_type;
+    config.n = N;
+    config.k = std::max<std::size_t>(1, N / 2 - 1);
+    config.devices = bench.devices;
+    config.threads = {bench.collide_threads};
+    config.batch_size = {bench.collide_batch_size};
+    const std::size_t walkers = bench.collide_threads * std::max<std::size_t>(queues.size(), 1);
+    const double expected = expected_vow_work(8 * N, 1, walkers, 8 * config.k);
+    // room for the DPs of the expected work, with the trails still open when it is done
+    config.expected_dps = std::max<std::size_t>(4096, 4 * static_cast<std::size_t>(std::ldexp(expected, -static_cast<int>(8 * config.k))));
+    config.dp_buffer_len = std::max<std::size_t>(4096, 4 * (walkers * config.batch_size[0] >> (8 * config.k)));
+
+    for (std::size_t run = 0; run <= bench.runs; ++run) {
+        // a prefix of its own makes every run walk another random function
+        config.prefix = {static_cast<uint8_t>(run >> 8), static_cast<uint8_t>(run), 0xbe, 0xec};
+        const auto walk = make_walk<HASH>(config);
+        const auto start = std::chrono::steady_clock::now();
+        std::optional<StageOneResult<HASH, N>> stage_one;
+        {
+            QuietCout silence;
+            stage_one = vow_stage_one<HASH, N>(queues, config, walk, nullptr, quiet);
+        }
+        const double seconds1 = elapsed_seconds(start, std::chrono::steady_clock::now());
+        if (!stage_one || !stage_one->found) {
+            std::cerr << "collide: stage 1 of N = " << N << " found no DP collision" << std::endl;
+            return;
+        }
+        auto [x_state, y_state] = vow_stage_two<HASH, N>(config, walk, *stage_one, quiet);
+        const double seconds = elapsed_seconds(start, std::chrono::steady_clock::now());
+        const std::size_t hashes = stage_one->total_hash_counts + x_state.hash_count + y_state.hash_count;
+        const bool found = x_state == y_state && x_state.in != y_state.in;
+        if (run == 0) {
+            continue;                   // warm-up: JIT compilation and the first DP table allocation
+        }
+        JsonLine(out).add("bench", "collide").add("hash", hash_name(bench.hash_type)).add("devices", bench.devices).add("n", N).add("k", config.k)
+            .add("run", run).add("walkers", walkers).add("batch_size", config.batch_size[0]).add("found", found)
+            .add("hashes", hashes).add("expected", expected).add("work_ratio", static_cast<double>(hashes) / expected)
+            .add("stage1_seconds", seconds1).add("seconds", seconds).add("rate", hash_rate(hashes, seconds));
+        std::cerr << "collide " << hash_name(bench.hash_type) << " N = " << N << " run " << run << ": " << hashes << " hashes, "
+            << static_cast<double>(hashes) / expected << " times the expected work, " << seconds << " seconds" << std::endl;
+    }
+}
+
+template <typename HASH, std::size_t... Ns>
+bool bench_collide_dispatch(std::size_t n, const BenchConfig &bench, std::vector<sycl::queue> &queues, std::ostream &out, std::index_sequence<Ns...>) {
+    bool supported = false;
+    ((n == Ns ? (supported = true, bench_collide_n<WALK_HASH<HASH, Ns>, Ns>(bench, queues, out), true) : false), ...);
+    return supported;
+}
+
+/**
+ * @brief the collide suite: --runs collisions of --hash for every --n
+ */
+void bench_collide(const BenchConfig &bench, std::vector<sycl::queue> &queues, std::ostream &out) {
+    with_hash(bench.hash_type, [&] (auto tag) {
+        using HASH = typename decltype(tag)::type;
+        for (const auto n : bench.n) {
+            if (!bench_collide_dispatch<HASH>(n, bench, queues, out, SUPPORTED_N{})) {
+                std::cerr << "collide: N = " << n << " has no pre-instantiated kernel (see SUPPORTED_N)" << std::endl;
+            }
+        }
+    });
+}
+
+
+int main(int argc, char **argv) {
+
+    const auto bench = parse_bench_args(argc, argv, std::cerr);
+    if (!bench) {
+        return 1;
+    }
+    const bool host = bench->devices == "host";
+    const auto devices = host ? std::vector<sycl::device>{} : select_devices(bench->devices);
+    if (!host && devices.empty()) {
+        std::cerr << "No device matches --devices " << bench->devices << " (see sha2_collision --devices list)" << std::endl;
+        return 1;
+    }
+    std::vector<sycl::queue> queues;
+    std::vector<std::string> names;
+    for (const auto &device : devices) {
+        queues.emplace_back(device);
+        names.push_back(device.get_info<sycl::info::device::name>());
+    }
+
+    std::ofstream file;
+    if (!bench->out.empty()) {
+        file.open(bench->out, std::ios::app);
+        if (!file) {
+            std::cerr << "Cannot append to " << bench->out << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = bench->out.empty() ? std::cout : file;
+    JsonLine(out).add("bench", "build").add("compiler", __VERSION__).add("built", __DATE__ " " __TIME__)
+        .add("lanes", LANES).add("midstate", MIDSTATE).add("truncate", TRUNCATE)
+        .add("host_threads", std::thread::hardware_concurrency()).add("host_simd", simd_backend_name(best_simd_backend(4)));
+
+    if (bench->runs_suite("compress")) {
+        bench_compress(*bench, queues, names, out);
+    }
+    if (bench->runs_suite("step")) {
+        bench_steps(*bench, queues, names, out);
+    }
+    if (bench->runs_suite("stage2")) {
+        bench_stage_two(*bench, out);
+    }
+    if (bench->runs_suite("collide")) {
+        bench_collide(*bench, queues, out);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file campaign.hpp
+ * @author Steven
+ * @brief The campaign driver of the command-line front-end: stage 1 on the selected devices, as the DP server or as one of its workers, then stage 2 and the report, for one campaign or every --targets entry
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <iostream>
+#include <filesystem>
+#include <vector>
+#include "config.hpp"
+#include "telemetry.hpp"
+#include "checkpoint.hpp"
+#include "dp_server.hpp"
+#include "launch.hpp"
+#include "stage_two.hpp"
+#include "vow.hpp"
+
+/**
+ * @brief one campaign on the queues of the selected devices: stage 1, stage 2 and the report
+ * @param uplink            if set, run stage 1 as a worker of the DP server
+ * @return                  false if stage 1 could not start
+ */
+template<typename HASH, std::size_t N>
+bool vow_campaign(const Config &config, std::vector<sycl::queue> &queues, DPUplink *uplink) {
+
+    const auto walk = make_walk<HASH>(config);
+    const bool server = config.listen_port != 0;
+    std::cout << "Starting VOW partial collision attack on " << hash_name(config.hash_type) << " with N = " << config.collision_bits() 
+        << " bits and K = " << config.dp_bits() << " bits" << std::endl;
+    std::cout << "Prefix: ";
+    print_arr(std::cout, config.prefix);
+    std::cout << "\nSuffix: ";
+    print_arr(std::cout, config.suffix);
+    std::cout << "\nSalt: ";
+    if (config.salt.empty()) {
+        std::cout << "none";
+    }
+    print_arr(std::cout, config.salt);
+    std::cout << std::endl;
+
+    divider();
+    auto start1 = std::chrono::steady_clock::now();
+    std::cout << std::dec << "Stage 1 started at: " << std::chrono::duration_cast<std::chrono::seconds>(start1.time_since_epoch()).count() << " seconds since epoch" << std::endl;
+    if (uplink) {
+        (void) vow_stage_one<HASH, N>(queues, config, walk, uplink);
+        return true;
+    }
+    const auto stage_one_result = server ? vow_dp_server<HASH, N>(config) : vow_stage_one<HASH, N>(queues, config, walk);
+    if (!stage_one_result) {
+        return false;
+    }
+    const auto &stage_one = *stage_one_result;
+    auto end1 = std::chrono::steady_clock::now();
+    auto seconds1 = elapsed_seconds(start1, end1);
+    std::cout << std::dec << "\nStage 1 ended in: " << seconds1 << " seconds (" << hash_rate(stage_one.total_hash_counts, seconds1) << " hashes per second)" << std::endl;
+    if (config.continuous()) {
+        return true;            // the collisions were streamed out during stage 1
+    }
+
+    divider();
+    auto start2 = std::chrono::steady_clock::now();
+    std::cout << std::dec << "Stage 2 started at: " << std::chrono::duration_cast<std::chrono::seconds>(start2.time_since_epoch()).count() << " seconds since epoch" << std::endl;
+    std::size_t stage_two_hash_counts = 0;
+    auto [x_state, y_state] = run_stage_two<HASH, N>(config, walk, stage_one, stage_two_hash_counts, std::cout);
+    auto end2 = std::chrono::steady_clock::now();
+    auto seconds2 = elapsed_seconds(start2, end2);
+    std::cout << std::dec << "\nStage 2 ended in: " << seconds2 << " seconds (" << hash_rate(stage_two_hash_counts, seconds2) << " hashes per second)" << std::endl;
+
+    divider();
+    std::size_t total_hash_counts = stage_one.total_hash_counts + stage_two_hash_counts;
+    (void) print_collision<HASH, N>(x_state, y_state, total_hash_counts, seconds1 + seconds2);
+    return true;
+}
+
+
+/**
+ * @brief settles the salt of a standalone campaign or of the DP server before its walk is built
+ *
+ * A resumed campaign walks with the salt of its checkpoint (an explicit --salt must match it), --salt random draws a fresh one,
+ * so a rerun walks another random function and does not repeat the chains of the previous run. A worker takes the server's salt instead,
+ * see connect_dp_server.
+ * @return                  false if the checkpoint holds no salt or another one (the reason is written to std::cerr)
+ */
+inline bool settle_salt(Config &config) {
+    if (config.resume) {
+        std::vector<uint8_t> stored;
+        if (!Checkpointer::read_file(std::filesystem::path(config.checkpoint_dir) / "salt.bin", stored) 
+            || (!stored.empty() && stored.size() != config.n) || (!config.random_salt && stored != config.salt)) {
+            std::cerr << "The checkpoint in " << config.checkpoint_dir << " holds no salt of this campaign or another one than --salt" << std::endl;
+            return false;
+        }
+        config.salt = std::move(stored);
+    } else if (config.random_salt) {
+        config.salt = draw_salt(config.n);
+    }
+    return true;
+}
+
+
+/**
+ * @return                  false if the configuration does not fit this (HASH, N) instantiation
+ */
+template<typename HASH, std::size_t N>
+bool vow_partial_collide(const Config &options) {
+
+    for (std::size_t t = 0; t < std::max<std::size_t>(options.targets.size(), 1); ++t) {
+        if (!walk_fits<HASH>(options.targets.empty() ? options : options.target(t))) {
+            std::cerr << "Prefix tail, N and suffix" << (options.targets.empty() ? "" : " of target " + std::to_string(t)) 
+                << " do not fit in " << MAX_TAIL_BLOCKS << " blocks of " << HASH::BLOCK_SIZE 
+                << " bytes (shorten the suffix or increase MAX_TAIL_BLOCKS)" << std::endl;
+            return false;
+        }
+    }
+    const bool worker = !options.server.empty();
+    std::vector<sycl::queue> queues;
+    std::size_t total_threads = 0;
+    const auto setup = setup_devices<HASH, N>(options, queues, total_threads, std::cout);
+    if (!setup) {
+        return false;
+    }
+    Config config = *setup;
+    if (!config.dp_store.empty() && !config.resume && std::filesystem::exists(config.dp_store)) {
+        std::cerr << "The DP store " << config.dp_store << " already exists (continue it with --resume or remove it)" << std::endl;
+        return false;
+    }
+    DPUplink uplink;
+    if (worker && !connect_dp_server(config, total_threads, uplink)) {
+        return false;
+    }
+    if (worker) {
+        config.salt = uplink.salt;
+    }
+    if (config.targets.empty()) {
+        return (worker || settle_salt(config)) && vow_campaign<HASH, N>(config, queues, worker ? &uplink : nullptr);
+    }
+
+    // the devices, their queues and the kernels JIT-compiled for them are reused by every target
+    auto start = std::chrono::steady_clock::now();
+    std::size_t failed = 0;
+    for (std::size_t t = 0; t < config.targets.size(); ++t) {
+        divider();
+        std::cout << std::dec << "Target " << t + 1 << " of " << config.targets.size() << std::endl;
+        auto target = config.target(t);
+        failed += !settle_salt(target) || !vow_campaign<HASH, N>(target, queues, nullptr);
+    }
+    auto seconds = elapsed_seconds(start, std::chrono::steady_clock::now());
+    divider();
+    std::cout << std::dec << config.targets.size() - failed << " of " << config.targets.size() << " targets done in " << seconds << " seconds" << std::endl;
+    return failed == 0;
+}
@@ -0,0 +1,270 @@
+/**
+ * @file checkpoint.hpp
+ * @author Steven
+ * @brief On-disk checkpoint of a stage-1 campaign: an append-only DP log and atomically replaced state snapshots, written by a background thread
+ * @version 0.1
+ * @date 2026-02-12
+ *
+ * A checkpoint directory holds
+ *  - campaign.bin: the campaign parameters (put_campaign), checked on resume,
+ *  - dps.log: every merged DP batch as a {uint32 length, payload} frame, only ever appended to,
+ *  - any number of named snapshots (walker states, server state, the salt), each replaced through a temporary file and a rename.
+ * A crash can only leave a torn last log frame, which is cut off on resume.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "dp_net.hpp"
+
+class Checkpointer
+{
+
+public:
+
+    using Replay = std::function<bool(const std::vector<uint8_t> &)>;
+
+    Checkpointer() = default;
+
+    ~Checkpointer() {
+        close();
+    }
+
+    Checkpointer(const Checkpointer &) = delete;
+    Checkpointer &operator=(const Checkpointer &) = delete;
+
+    /**
+     * @brief opens (or creates) the checkpoint in `dir` and starts the writer thread
+     * @param campaign          put_campaign bytes of this campaign
+     * @param resume            continue the checkpoint in `dir`, replaying its DP log through `replay`; otherwise `dir` must not hold a DP log yet
+     * @param replay            called with the payload of every log frame in order, returns false if the frame is malformed
+     * @return                  false if the checkpoint cannot be opened or does not belong to this campaign (the reason is written to `err`)
+     */
+    bool open(const std::string &dir, const std::vector<uint8_t> &campaign, bool resume, const Replay &replay, std::ostream &err) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        root = dir;
+        const auto log_path = root / "dps.log";
+        if (resume) {
+            std::vector<uint8_t> stored;
+            if (!load("campaign.bin", stored) || stored != campaign) {
+                err << "The checkpoint in " << dir << " is missing or belongs to another campaign" << std::endl;
+                return false;
+            }
+            if (!replay_log(log_path, replay, err)) {
+                return false;
+            }
+        } else {
+            if (std::filesystem::file_size(log_path, ec) > 0 && !ec) {
+                err << "A checkpoint already exists in " << dir << " (continue it with --resume or use another directory)" << std::endl;
+                return false;
+            }
+            if (!write_file("campaign.bin", campaign)) {
+                err << "Cannot write the checkpoint in " << dir << std::endl;
+                return false;
+            }
+        }
+        log = std::fopen(log_path.string().c_str(), "ab");
+        if (!log) {
+            err << "Cannot open " << log_path.string() << " for appending" << std::endl;
+            return false;
+        }
+        writer = std::thread([this] { work(); });
+        return true;
+    }
+
+    bool is_open() const noexcept {
+        return log != nullptr;
+    }
+
+    /**
+     * @brief false once any write failed, the checkpoint then stops being updated
+     */
+    bool healthy() const noexcept {
+        std::lock_guard lock(mutex);
+        return !failed;
+    }
+
+    /**
+     * @brief queues one frame to be appended to the DP log
+     */
+    void append_log(std::vector<uint8_t> payload) {
+        push(Job{std::string{}, std::move(payload), {}});
+    }
+
+    /**
+     * @brief queues a snapshot to replace `name`, after every log frame queued before it
+     */
+    void save(std::string name, std::vector<uint8_t> bytes) {
+        push(Job{std::move(name), std::move(bytes), {}});
+    }
+
+    /**
+     * @brief queues `task` (like flushing a mapped DP store to its file), in order with the log frames and snapshots
+     */
+    void call(std::function<bool()> task) {
+        push(Job{std::string{}, {}, std::move(task)});
+    }
+
+    /**
+     * @brief reads the snapshot `name` (synchronously, meant for resuming)
+     */
+    bool load(const std::string &name, std::vector<uint8_t> &bytes) const {
+        return read_file(root / name, bytes);
+    }
+
+    /**
+     * @brief reads a file of a checkpoint that is not open, e.g. a snapshot needed before the campaign starts
+     */
+    static bool read_file(const std::filesystem::path &path, std::vector<uint8_t> &bytes) {
+        std::FILE *file = std::fopen(path.string().c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        bytes.clear();
+        uint8_t buffer[1 << 16];
+        std::size_t read = 0;
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            bytes.insert(bytes.end(), buffer, buffer + read);
+        }
+        const bool ok = !std::ferror(file);
+        std::fclose(file);
+        return ok;
+    }
+
+    /**
+     * @brief writes everything queued so far, then stops the writer thread
+     */
+    void close() {
+        if (!writer.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        cv.notify_one();
+        writer.join();
+        std::fclose(log);
+        log = nullptr;
+    }
+
+private:
+
+    struct Job {
+        std::string name;               // snapshot to replace, or empty for a log frame
+        std::vector<uint8_t> bytes;
+        std::function<bool()> task;     // if set, run instead of writing
+    };
+
+    std::filesystem::path root;
+    std::FILE *log = nullptr;
+    std::thread writer;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> jobs;
+    bool stop = false;
+    bool failed = false;
+
+    void push(Job job) {
+        {
+            std::lock_guard lock(mutex);
+            if (failed || stop) {
+                return;
+            }
+            jobs.push_back(std::move(job));
+        }
+        cv.notify_one();
+    }
+
+    void work() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] { return stop || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            const bool ok = job.task ? job.task() : job.name.empty() ? write_frame(job.bytes) : write_file(job.name, job.bytes);
+            if (!ok) {
+                std::lock_guard lock(mutex);
+                failed = true;
+                jobs.clear();
+            }
+        }
+    }
+
+    bool write_frame(const std::vector<uint8_t> &payload) {
+        WireWriter header;
+        header.put_u32(static_cast<uint32_t>(payload.size()));
+        return std::fwrite(header.bytes.data(), 1, header.bytes.size(), log) == header.bytes.size()
+            && std::fwrite(payload.data(), 1, payload.size(), log) == payload.size()
+            && std::fflush(log) == 0;
+    }
+
+    bool write_file(const std::string &name, const std::vector<uint8_t> &bytes) const {
+        const auto path = root / name;
+        auto temporary = path;
+        temporary += ".tmp";
+        std::FILE *file = std::fopen(temporary.string().c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        if (std::fclose(file) != 0 || !written) {
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(temporary, path, ec);
+        return !ec;
+    }
+
+    /**
+     * @brief replays every complete frame of the log and cuts off a torn last frame
+     */
+    static bool replay_log(const std::filesystem::path &path, const Replay &replay, std::ostream &err) {
+        std::FILE *file = std::fopen(path.string().c_str(), "rb");
+        if (!file) {
+            return true;                // nothing was merged before the previous run stopped
+        }
+        std::size_t good_size = 0;
+        std::vector<uint8_t> header(4), payload;
+        bool ok = true;
+        while (std::fread(header.data(), 1, header.size(), file) == header.size()) {
+            WireReader reader(header);
+            payload.resize(reader.get_u32());
+            if (std::fread(payload.data(), 1, payload.size(), file) != payload.size()) {
+                break;
+            }
+            if (!replay(payload)) {
+                err << "Malformed DP log frame at byte " << good_size << " of " << path.string() << std::endl;
+                ok = false;
+                break;
+            }
+            good_size += header.size() + payload.size();
+        }
+        std::fclose(file);
+        std::error_code ec;
+        if (ok && std::filesystem::file_size(path, ec) != good_size && !ec) {
+            std::filesystem::resize_file(path, good_size, ec);
+        }
+        return ok && !ec;
+    }
+
+};
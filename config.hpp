@@ -0,0 +1,433 @@
+/**
+ * @file config.hpp
+ * @author Steven
+ * @brief Run-time configuration of a VOW campaign and its command-line front-end, so the hash function, the collision and DP lengths, the prefix and suffix, the devices and the launch sizes can change without recompiling
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class HASH_TYPE {
+    SHA224, SHA256,
+    SHA384, SHA512, SHA512_224, SHA512_256
+};
+
+constexpr std::array<std::pair<std::string_view, HASH_TYPE>, 6> HASH_NAMES = {{
+    {"sha224", HASH_TYPE::SHA224}, {"sha256", HASH_TYPE::SHA256},
+    {"sha384", HASH_TYPE::SHA384}, {"sha512", HASH_TYPE::SHA512},
+    {"sha512_224", HASH_TYPE::SHA512_224}, {"sha512_256", HASH_TYPE::SHA512_256}
+}};
+
+/**
+ * @brief parameters of one campaign, the defaults are the former compile-time settings
+ */
+struct Config {
+    HASH_TYPE hash_type = HASH_TYPE::SHA256;    // --hash: hash function to attack
+    std::size_t n = 8;                          // --n: partial collision length in bytes (one of the pre-instantiated lengths)
+    std::size_t n_bits = 0;                     // --n-bits: partial collision length in bits, n is the bytes holding them (0: 8 n)
+    std::size_t k = 2;                          // --k: distinguishable point condition length in bytes (k <= n)
+    std::size_t k_bits = 0;                     // --k-bits: distinguishable point condition length in bits, k is its whole bytes (0: 8 k)
+    bool plan = false;                          // --k auto: the planner picks k, the batch sizes and the DP buffer and table sizes from dp_table_bytes and the measured step rates
+    std::vector<uint8_t> prefix = {0x00, 0x11, 0x22, 0x33};     // --prefix: constant bytes before the N variable bytes (hex)
+    std::vector<uint8_t> suffix = {0x33, 0x22, 0x11, 0x00};     // --suffix: constant bytes after the N variable bytes (hex)
+    std::vector<uint8_t> salt;                  // --salt: n bytes XORed into the variable bytes of every input, so every campaign walks its own random function (hex, empty: none)
+    bool random_salt = true;                    // --salt random: draw the salt when the campaign starts (a resumed campaign keeps its own, a worker takes the server's)
+    std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> targets;     // --targets: (prefix, suffix) pairs run one after the other on the same devices instead of --prefix/--suffix
+    std::string devices = "default";            // --devices: stage-1 devices, `default`, `cpu`, `gpu`, `all`, `host` (the SIMD host backend instead of SYCL), `list` or comma-separated indices into the device list
+    std::string host_simd = "auto";             // --host-simd: kernel of `--devices host`, `auto` (the fastest this CPU runs), `scalar`, `avx2`, `avx512` or `sha-ni`
+    std::string word_pairs = "auto";            // --word-pairs: compute the 64-bit words of the SHA-512 family as 32-bit pairs on the SYCL devices, `auto` (on devices with weak 64-bit integers), `on` or `off`
+    std::vector<std::size_t> threads = {20'000};        // --threads: number of parallel walkers per device (comma-separated, the last value repeats)
+    std::vector<std::size_t> batch_size = {100'000};    // --batch-size: steps of every walker between two DP merges per device (comma-separated, the last value repeats)
+    std::vector<std::size_t> work_group = {0};          // --work-group: work-items per work-group of the stage-1 kernel per device (comma-separated, the last value repeats; 0: the runtime picks)
+    bool autotune = false;                      // --autotune: pick threads, batch size and work-group size of every device with trial batches, or take them from tune_cache
+    std::string tune_cache = "vow_tune.cache";  // --tune-cache: file the --autotune results are kept in, per device name, hash function and N
+    std::size_t tune_kernel_ms = 200;           // --tune-kernel-ms: batch kernel duration --autotune and --k auto size the batches for
+    std::size_t dp_buffer_len = 1 << 20;        // --dp-buffer-len: DPs all walkers can report in one batch (extra DPs are dropped and reported)
+    std::size_t dp_table_bytes = std::size_t{1} << 30;      // --dp-table-bytes: memory budget of the host DP table (with --k auto, of the DP table and the host DP buffers)
+    std::size_t merge_threads = 4;              // --merge-threads: host threads merging DPs, one DP table shard each (a power of two)
+    std::size_t max_trail = 0;                  // --max-trail: steps without a DP after which a walker restarts elsewhere (0: 20 * 2^(8K))
+    std::size_t expected_dps = 0;               // --expected-dps: size the DP table for this many DPs instead of --dp-table-bytes (0: use the byte budget)
+    std::string dp_store;                       // --dp-store: file the DP table is memory-mapped from, so it can outgrow RAM (empty: in RAM)
+    std::string server;                         // --server: HOST:PORT of a DP server, run as a worker streaming DPs to it instead of merging them
+    std::size_t listen_port = 0;                // --listen: run as the DP server on this port, collecting the DPs of workers and running stage 2 (0: standalone)
+    std::size_t collisions = 1;                 // --collisions: distinct collisions to find, more than one keeps stage 1 walking and runs stage 2 in the background (0: until --time-limit)
+    std::size_t time_limit = 0;                 // --time-limit: seconds after which a continuous campaign stops (0: none)
+    std::string checkpoint_dir;                 // --checkpoint: directory of the DP log and the walker state snapshots (empty: no checkpoint)
+    std::size_t checkpoint_interval = 600;      // --checkpoint-interval: seconds between two walker state snapshots of a device
+    bool resume = false;                        // --resume: continue the campaign checkpointed in checkpoint_dir
+    std::string telemetry;                      // --telemetry: file one JSON line per merged batch is appended to, with profiled kernel and copy times (empty: none)
+
+    std::size_t collision_bits() const noexcept {
+        return n_bits > 0 ? n_bits : 8 * n;
+    }
+
+    std::size_t dp_bits() const noexcept {
+        return k_bits > 0 ? k_bits : 8 * k;
+    }
+
+    std::size_t threads_of(std::size_t device) const noexcept {
+        return threads[std::min(device, threads.size() - 1)];
+    }
+
+    std::size_t batch_size_of(std::size_t device) const noexcept {
+        return batch_size[std::min(device, batch_size.size() - 1)];
+    }
+
+    std::size_t work_group_of(std::size_t device) const noexcept {
+        return work_group[std::min(device, work_group.size() - 1)];
+    }
+
+    /**
+     * @brief the campaign of target `t`, with its prefix and suffix
+     */
+    Config target(std::size_t t) const {
+        Config config = *this;
+        config.prefix = targets[t].first;
+        config.suffix = targets[t].second;
+        config.targets.clear();
+        return config;
+    }
+
+    /**
+     * @brief whether stage 1 goes on after a DP collision, streaming out the collisions as stage 2 finds them
+     */
+    bool continuous() const noexcept {
+        return collisions != 1 || time_limit > 0;
+    }
+};
+
+inline std::string_view hash_name(HASH_TYPE hash_type) noexcept {
+    for (const auto &[name, type] : HASH_NAMES) {
+        if (type == hash_type) {
+            return name;
+        }
+    }
+    return "unknown";
+}
+
+inline void print_usage(std::ostream &os, std::string_view program) {
+    const Config defaults;
+    os << "Usage: " << program << " [options]\n"
+        << "  --hash NAME             sha224, sha256, sha384, sha512, sha512_224 or sha512_256 (default " << hash_name(defaults.hash_type) << ")\n"
+        << "  --n BYTES               partial collision length (default " << defaults.n << ")\n"
+        << "  --n-bits BITS           partial collision length in bits instead of bytes\n"
+        << "  --k BYTES|auto          distinguishable point condition length, at most n, or planned from the memory budget (default " << defaults.k << ")\n"
+        << "  --k-bits BITS           distinguishable point condition length in bits instead of bytes\n"
+        << "  --prefix HEX            constant bytes before the variable bytes (default 00112233)\n"
+        << "  --suffix HEX            constant bytes after the variable bytes (default 33221100)\n"
+        << "  --salt HEX|random|none  n bytes XORed into the variable bytes of every input, random draws them per campaign (default random)\n"
+        << "  --targets FILE          run every `PREFIX SUFFIX` line of FILE (hex, - for none) in turn on the same devices\n"
+        << "  --devices SPEC          default, cpu, gpu (all GPUs of one platform), all (GPUs and CPU), host (SIMD host kernels, no SYCL), list, or indices like 0,2 (default " << defaults.devices << ")\n"
+        << "  --host-simd KERNEL      kernel of --devices host: auto, scalar, avx2, avx512 or sha-ni (default " << defaults.host_simd << ")\n"
+        << "  --word-pairs MODE       64-bit words of sha384/sha512 as 32-bit pairs on the devices: auto, on or off (default " << defaults.word_pairs << ")\n"
+        << "  --threads COUNT[,...]   parallel walkers per device, the last value repeats (default " << defaults.threads[0] << ")\n"
+        << "  --batch-size STEPS[,...] steps per walker between DP merges per device, the last value repeats (default " << defaults.batch_size[0] << ")\n"
+        << "  --work-group ITEMS[,...] work-items per work-group per device, the last value repeats (0: runtime default)\n"
+        << "  --autotune              pick --threads, --batch-size and --work-group per device with trial batches (cached in --tune-cache)\n"
+        << "  --tune-cache FILE       file of the cached --autotune results (default " << defaults.tune_cache << ")\n"
+        << "  --tune-kernel-ms MS     batch kernel duration --autotune and --k auto aim at (default " << defaults.tune_kernel_ms << ")\n"
+        << "  --dp-buffer-len COUNT   DPs reported per batch before dropping (default " << defaults.dp_buffer_len << ")\n"
+        << "  --dp-table-bytes BYTES  memory budget of the host DP table, and of the DP buffers with --k auto (default " << defaults.dp_table_bytes << ")\n"
+        << "  --merge-threads COUNT   host threads merging DPs, a power of two (default " << defaults.merge_threads << ")\n"
+        << "  --max-trail STEPS       steps without a DP before a walker restarts elsewhere (default 20 * 2^(8k))\n"
+        << "  --expected-dps COUNT    size the DP table for COUNT DPs instead of --dp-table-bytes\n"
+        << "  --dp-store FILE         memory-map the DP table from FILE, so it can be larger than RAM\n"
+        << "  --listen PORT           run as the DP server of a multi-node campaign\n"
+        << "  --server HOST:PORT      run as a worker of the DP server at HOST:PORT\n"
+        << "  --collisions COUNT      distinct collisions to find, stage 1 keeps walking and reuses its DP table (0: until --time-limit, default " << defaults.collisions << ")\n"
+        << "  --time-limit SECONDS    stop a continuous campaign after SECONDS\n"
+        << "  --checkpoint DIR        append merged DPs to DIR/dps.log and snapshot the walker states there\n"
+        << "  --checkpoint-interval SECONDS  seconds between walker state snapshots (default " << defaults.checkpoint_interval << ")\n"
+        << "  --resume                continue the campaign checkpointed in the --checkpoint directory\n"
+        << "  --telemetry FILE        append per-batch timings, DP rate, DP table load and ETA to FILE as JSON lines\n"
+        << "  --help                  print this message\n";
+}
+
+inline bool parse_size(std::string_view text, std::size_t &out) noexcept {
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc{} && end == text.data() + text.size();
+}
+
+/**
+ * @brief parses a comma-separated list of sizes of at least `min_value`
+ */
+inline bool parse_sizes(std::string_view text, std::vector<std::size_t> &out, std::size_t min_value = 1) {
+    out.clear();
+    while (true) {
+        const auto comma = text.find(',');
+        std::size_t value = 0;
+        if (!parse_size(text.substr(0, comma), value) || value < min_value) {
+            return false;
+        }
+        out.push_back(value);
+        if (comma == std::string_view::npos) {
+            return true;
+        }
+        text.remove_prefix(comma + 1);
+    }
+}
+
+inline bool parse_hex(std::string_view text, std::vector<uint8_t> &out) {
+    if (text.size() % 2 != 0) {
+        return false;
+    }
+    out.resize(text.size() / 2);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        const auto [end, ec] = std::from_chars(text.data() + 2 * i, text.data() + 2 * i + 2, out[i], 16);
+        if (ec != std::errc{} || end != text.data() + 2 * i + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief reads one `PREFIX SUFFIX` target per line, in hex with `-` for no bytes (blank lines and lines starting with # are skipped)
+ * @return                  false if the file cannot be read or a line is malformed (the reason is written to `err`)
+ */
+inline bool load_targets(const std::string &path, std::vector<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> &targets, std::ostream &err) {
+    std::ifstream file(path);
+    if (!file) {
+        err << "Cannot read the targets file " << path << "\n";
+        return false;
+    }
+    targets.clear();
+    std::string line;
+    for (std::size_t line_number = 1; std::getline(file, line); ++line_number) {
+        std::string_view rest = line;
+        std::array<std::string_view, 3> fields;
+        std::size_t count = 0;
+        while (count < fields.size()) {
+            const auto begin = rest.find_first_not_of(" \t\r");
+            if (begin == std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(begin);
+            const auto end = std::min(rest.find_first_of(" \t\r"), rest.size());
+            fields[count++] = rest.substr(0, end);
+            rest.remove_prefix(end);
+        }
+        if (count == 0 || fields[0].front() == '#') {
+            continue;
+        }
+        std::pair<std::vector<uint8_t>, std::vector<uint8_t>> target;
+        if (count != 2 || (fields[0] != "-" && !parse_hex(fields[0], target.first)) || (fields[1] != "-" && !parse_hex(fields[1], target.second))) {
+            err << path << ":" << line_number << ": expected `PREFIX SUFFIX` in hex (- for none)\n";
+            return false;
+        }
+        targets.push_back(std::move(target));
+    }
+    if (targets.empty()) {
+        err << "The targets file " << path << " holds no target\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief launch sizes of the stage-1 kernel on one device
+ */
+struct LaunchSizes {
+    std::size_t threads = 0;
+    std::size_t batch_size = 0;
+    std::size_t work_group = 0;                 // 0: the runtime picks
+};
+
+/**
+ * @brief the launch sizes cached for `key` in the --tune-cache file, one `THREADS BATCH_SIZE WORK_GROUP KEY` line per entry (the last line of a key wins)
+ * @return                  nothing if the file cannot be read or holds no line for `key`
+ */
+inline std::optional<LaunchSizes> load_tuning(const std::string &path, std::string_view key) {
+    std::ifstream file(path);
+    std::optional<LaunchSizes> found;
+    LaunchSizes sizes;
+    std::string rest;
+    while (file >> sizes.threads >> sizes.batch_size >> sizes.work_group && std::getline(file, rest)) {
+        if (!rest.empty() && std::string_view(rest).substr(1) == key) {
+            found = sizes;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief appends the launch sizes tuned for `key` to the --tune-cache file
+ */
+inline bool save_tuning(const std::string &path, std::string_view key, const LaunchSizes &sizes) {
+    std::ofstream file(path, std::ios::app);
+    file << sizes.threads << " " << sizes.batch_size << " " << sizes.work_group << " " << key << "\n";
+    return static_cast<bool>(file.flush());
+}
+
+/**
+ * @brief parses the command line into a Config, starting from the defaults
+ *
+ * Only the checks that do not depend on the hash function are done here,
+ * the supported lengths and the fit of the prefix and suffix are checked by the campaign itself.
+ * @return                  the configuration, or nothing if the arguments are invalid or --help was given (the reason is written to `err`)
+ */
+inline std::optional<Config> parse_args(int argc, char **argv, std::ostream &err) {
+    Config config;
+    const std::string_view program = argc > 0 ? argv[0] : "vow";
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view option = argv[i];
+        if (option == "--help") {
+            print_usage(err, program);
+            return std::nullopt;
+        }
+        if (option == "--resume") {
+            config.resume = true;
+            continue;
+        }
+        if (option == "--autotune") {
+            config.autotune = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            err << "Missing value for " << option << "\n";
+            print_usage(err, program);
+            return std::nullopt;
+        }
+        const std::string_view value = argv[++i];
+        bool ok = true;
+        if (option == "--hash") {
+            ok = false;
+            for (const auto &[name, type] : HASH_NAMES) {
+                if (value == name) {
+                    config.hash_type = type;
+                    ok = true;
+                }
+            }
+        } else if (option == "--n") {
+            config.n_bits = 0;
+            ok = parse_size(value, config.n);
+        } else if (option == "--n-bits") {
+            ok = parse_size(value, config.n_bits) && config.n_bits > 0;
+            config.n = (config.n_bits + 7) / 8;
+        } else if (option == "--k") {
+            config.plan = value == "auto";
+            config.k_bits = 0;
+            ok = config.plan || parse_size(value, config.k);
+        } else if (option == "--k-bits") {
+            config.plan = false;
+            ok = parse_size(value, config.k_bits) && config.k_bits > 0;
+            config.k = config.k_bits / 8;
+        } else if (option == "--prefix") {
+            ok = parse_hex(value, config.prefix);
+        } else if (option == "--suffix") {
+            ok = parse_hex(value, config.suffix);
+        } else if (option == "--salt") {
+            config.random_salt = value == "random";
+            config.salt.clear();
+            ok = config.random_salt || value == "none" || (parse_hex(value, config.salt) && !config.salt.empty());
+        } else if (option == "--targets") {
+            if (!load_targets(std::string(value), config.targets, err)) {
+                return std::nullopt;
+            }
+        } else if (option == "--devices") {
+            config.devices = value;
+        } else if (option == "--host-simd") {
+            config.host_simd = value;
+            ok = value == "auto" || value == "scalar" || value == "avx2" || value == "avx512" || value == "sha-ni";
+        } else if (option == "--word-pairs") {
+            config.word_pairs = value;
+            ok = value == "auto" || value == "on" || value == "off";
+        } else if (option == "--threads") {
+            ok = parse_sizes(value, config.threads);
+        } else if (option == "--batch-size") {
+            ok = parse_sizes(value, config.batch_size);
+        } else if (option == "--work-group") {
+            ok = parse_sizes(value, config.work_group, 0);
+        } else if (option == "--tune-cache") {
+            config.tune_cache = value;
+            ok = !value.empty();
+        } else if (option == "--tune-kernel-ms") {
+            ok = parse_size(value, config.tune_kernel_ms) && config.tune_kernel_ms > 0;
+        } else if (option == "--dp-buffer-len") {
+            ok = parse_size(value, config.dp_buffer_len) && config.dp_buffer_len > 0 && config.dp_buffer_len <= UINT32_MAX;
+        } else if (option == "--dp-table-bytes") {
+            ok = parse_size(value, config.dp_table_bytes);
+        } else if (option == "--server") {
+            config.server = value;
+        } else if (option == "--listen") {
+            ok = parse_size(value, config.listen_port) && config.listen_port > 0 && config.listen_port <= UINT16_MAX;
+        } else if (option == "--max-trail") {
+            ok = parse_size(value, config.max_trail) && config.max_trail > 0 && config.max_trail <= UINT32_MAX;
+        } else if (option == "--expected-dps") {
+            ok = parse_size(value, config.expected_dps) && config.expected_dps > 0;
+        } else if (option == "--dp-store") {
+            config.dp_store = value;
+            ok = !value.empty();
+        } else if (option == "--collisions") {
+            ok = parse_size(value, config.collisions);
+        } else if (option == "--time-limit") {
+            ok = parse_size(value, config.time_limit) && config.time_limit > 0;
+        } else if (option == "--checkpoint") {
+            config.checkpoint_dir = value;
+            ok = !value.empty();
+        } else if (option == "--checkpoint-interval") {
+            ok = parse_size(value, config.checkpoint_interval) && config.checkpoint_interval > 0;
+        } else if (option == "--telemetry") {
+            config.telemetry = value;
+            ok = !value.empty();
+        } else if (option == "--merge-threads") {
+            ok = parse_size(value, config.merge_threads) && config.merge_threads > 0
+                && (config.merge_threads & (config.merge_threads - 1)) == 0;
+        } else {
+            err << "Unknown option " << option << "\n";
+            print_usage(err, program);
+            return std::nullopt;
+        }
+        if (!ok) {
+            err << "Invalid value for " << option << ": " << value << "\n";
+            return std::nullopt;
+        }
+    }
+    if (!config.server.empty() && config.listen_port != 0) {
+        err << "--server and --listen are exclusive\n";
+        return std::nullopt;
+    }
+    if (config.resume && config.checkpoint_dir.empty()) {
+        err << "--resume needs the --checkpoint directory to resume from\n";
+        return std::nullopt;
+    }
+    if (!config.checkpoint_dir.empty() && !config.server.empty()) {
+        err << "--checkpoint is kept by the DP server, a restarted worker just rejoins it\n";
+        return std::nullopt;
+    }
+    if (!config.targets.empty() && (!config.server.empty() || config.listen_port != 0 || !config.checkpoint_dir.empty() || !config.dp_store.empty())) {
+        err << "--targets runs standalone campaigns, without --server, --listen, --checkpoint or --dp-store\n";
+        return std::nullopt;
+    }
+    if (config.collisions == 0 && config.time_limit == 0) {
+        err << "--collisions 0 needs a --time-limit\n";
+        return std::nullopt;
+    }
+    if (config.plan && (!config.server.empty() || config.listen_port != 0 || config.resume || config.expected_dps > 0)) {
+        err << "--k auto plans a standalone campaign, without --server, --listen, --resume (pass the K it printed) or --expected-dps\n";
+        return std::nullopt;
+    }
+    if (!config.salt.empty() && config.salt.size() != config.n) {
+        err << "--salt takes n (" << config.n << ") bytes, got " << config.salt.size() << "\n";
+        return std::nullopt;
+    }
+    if (!config.plan && config.dp_bits() > config.collision_bits()) {
+        err << "k (" << config.dp_bits() << " bits) must not exceed n (" << config.collision_bits() << " bits)\n";
+        return std::nullopt;
+    }
+    return config;
+}
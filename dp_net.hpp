@@ -0,0 +1,447 @@
+/**
+ * @file dp_net.hpp
+ * @author Steven
+ * @brief Minimal blocking TCP transport and wire format between stage-1 workers and the distributed DP server
+ * @version 0.1
+ * @date 2026-02-12
+ *
+ * A worker connects and sends HELLO with its campaign parameters and walker count. The server replies
+ * ASSIGN with the first seed of the worker's seed range, or REJECT if the campaign does not match its own.
+ * The worker then streams one DP_BATCH per stage-1 batch, and the server sends STOP once a DP collided.
+ * Every message is a little-endian {uint32 type, uint32 payload length} header followed by the payload.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "config.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief owning, move-only TCP socket with all-or-nothing blocking sends and receives
+ */
+class Socket
+{
+
+public:
+
+#ifdef _WIN32
+    using native_t = SOCKET;
+    static constexpr native_t INVALID = INVALID_SOCKET;
+#else
+    using native_t = int;
+    static constexpr native_t INVALID = -1;
+#endif
+
+    Socket() noexcept = default;
+    explicit Socket(native_t fd) noexcept : fd(fd) {}
+    Socket(Socket &&other) noexcept : fd(other.fd) {
+        other.fd = INVALID;
+    }
+    Socket &operator=(Socket &&other) noexcept {
+        if (this != &other) {
+            close();
+            fd = other.fd;
+            other.fd = INVALID;
+        }
+        return *this;
+    }
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+    ~Socket() {
+        close();
+    }
+
+    /**
+     * @return                  a connected socket, or an invalid one if `host:port` cannot be reached
+     */
+    static Socket connect(const std::string &host, uint16_t port) noexcept {
+        if (!startup()) {
+            return Socket{};
+        }
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+            return Socket{};
+        }
+        Socket socket;
+        for (auto *a = addresses; a != nullptr && !socket.valid(); a = a->ai_next) {
+            Socket candidate{::socket(a->ai_family, a->ai_socktype, a->ai_protocol)};
+            if (candidate.valid() && ::connect(candidate.fd, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) {
+                socket = std::move(candidate);
+            }
+        }
+        freeaddrinfo(addresses);
+        socket.set_no_delay();
+        return socket;
+    }
+
+    /**
+     * @return                  a socket listening on `port` on all interfaces, or an invalid one
+     */
+    static Socket listen(uint16_t port) noexcept {
+        if (!startup()) {
+            return Socket{};
+        }
+        Socket socket{::socket(AF_INET, SOCK_STREAM, 0)};
+        if (!socket.valid()) {
+            return socket;
+        }
+        const int reuse = 1;
+        setsockopt(socket.fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (::bind(socket.fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || ::listen(socket.fd, 64) != 0) {
+            return Socket{};
+        }
+        return socket;
+    }
+
+    /**
+     * @brief waits up to `timeout_ms` for a connection
+     * @return                  the accepted socket, or an invalid one on timeout or error
+     */
+    Socket accept(int timeout_ms) const noexcept {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(fd, &readable);
+        timeval timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        if (select(static_cast<int>(fd) + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+            return Socket{};
+        }
+        Socket socket{::accept(fd, nullptr, nullptr)};
+        socket.set_no_delay();
+        return socket;
+    }
+
+    bool send_all(const void *data, std::size_t size) const noexcept {
+        const auto *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            const auto sent = ::send(fd, bytes, static_cast<int>(std::min<std::size_t>(size, 1 << 30)), SEND_FLAGS);
+            if (sent <= 0) {
+                return false;
+            }
+            bytes += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+    bool recv_all(void *data, std::size_t size) const noexcept {
+        auto *bytes = static_cast<char *>(data);
+        while (size > 0) {
+            const auto received = ::recv(fd, bytes, static_cast<int>(std::min<std::size_t>(size, 1 << 30)), 0);
+            if (received <= 0) {
+                return false;
+            }
+            bytes += received;
+            size -= static_cast<std::size_t>(received);
+        }
+        return true;
+    }
+
+    /**
+     * @brief bounds every later receive call to `timeout_ms`, so a silent peer fails the receive (0: wait forever)
+     */
+    void set_recv_timeout(int timeout_ms) const noexcept {
+        if (valid()) {
+#ifdef _WIN32
+            const DWORD timeout = static_cast<DWORD>(timeout_ms);
+#else
+            const timeval timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+#endif
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+        }
+    }
+
+    /**
+     * @brief ends both directions, so a receive blocked on another thread returns
+     */
+    void shutdown() const noexcept {
+        if (valid()) {
+#ifdef _WIN32
+            ::shutdown(fd, SD_BOTH);
+#else
+            ::shutdown(fd, SHUT_RDWR);
+#endif
+        }
+    }
+
+    bool valid() const noexcept {
+        return fd != INVALID;
+    }
+
+    void close() noexcept {
+        if (valid()) {
+#ifdef _WIN32
+            closesocket(fd);
+#else
+            ::close(fd);
+#endif
+            fd = INVALID;
+        }
+    }
+
+private:
+
+#ifdef MSG_NOSIGNAL
+    static constexpr int SEND_FLAGS = MSG_NOSIGNAL;     // a closed peer fails the send instead of raising SIGPIPE
+#else
+    static constexpr int SEND_FLAGS = 0;
+#endif
+
+    native_t fd = INVALID;
+
+    static bool startup() noexcept {
+#ifdef _WIN32
+        static const bool started = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return started;
+#else
+        return true;
+#endif
+    }
+
+    void set_no_delay() const noexcept {
+        if (valid()) {
+            const int no_delay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&no_delay), sizeof(no_delay));
+        }
+    }
+
+};
+
+
+/**
+ * @brief little-endian message payload builder
+ */
+class WireWriter
+{
+
+public:
+
+    std::vector<uint8_t> bytes;
+
+    void put_u8(uint8_t v) {
+        bytes.push_back(v);
+    }
+
+    void put_u16(uint16_t v) {
+        put_le(v, 2);
+    }
+
+    void put_u32(uint32_t v) {
+        put_le(v, 4);
+    }
+
+    void put_u64(uint64_t v) {
+        put_le(v, 8);
+    }
+
+    /**
+     * @brief LEB128 varint, so small values (like short chain lengths) take a single byte
+     */
+    void put_varint(uint64_t v) {
+        for (; v >= 0x80; v >>= 7) {
+            bytes.push_back(static_cast<uint8_t>(v | 0x80));
+        }
+        bytes.push_back(static_cast<uint8_t>(v));
+    }
+
+    void put_bytes(const uint8_t *data, std::size_t size) {
+        bytes.insert(bytes.end(), data, data + size);
+    }
+
+private:
+
+    void put_le(uint64_t v, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i) {
+            bytes.push_back(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+
+};
+
+
+/**
+ * @brief little-endian message payload reader, every read past the end fails `ok()` and returns zeros
+ */
+class WireReader
+{
+
+public:
+
+    WireReader(const std::vector<uint8_t> &bytes) noexcept : pos(bytes.data()), end(bytes.data() + bytes.size()) {}
+
+    uint8_t get_u8() noexcept {
+        return static_cast<uint8_t>(get_le(1));
+    }
+
+    uint16_t get_u16() noexcept {
+        return static_cast<uint16_t>(get_le(2));
+    }
+
+    uint32_t get_u32() noexcept {
+        return static_cast<uint32_t>(get_le(4));
+    }
+
+    uint64_t get_u64() noexcept {
+        return get_le(8);
+    }
+
+    uint64_t get_varint() noexcept {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = get_u8();
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return v;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    void get_bytes(uint8_t *out, std::size_t size) noexcept {
+        if (remaining() < size) {
+            failed = true;
+            std::memset(out, 0, size);
+            return;
+        }
+        std::memcpy(out, pos, size);
+        pos += size;
+    }
+
+    std::size_t remaining() const noexcept {
+        return static_cast<std::size_t>(end - pos);
+    }
+
+    bool ok() const noexcept {
+        return !failed;
+    }
+
+private:
+
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool failed = false;
+
+    uint64_t get_le(std::size_t size) noexcept {
+        if (remaining() < size) {
+            failed = true;
+            return 0;
+        }
+        uint64_t v = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            v |= static_cast<uint64_t>(pos[i]) << (8 * i);
+        }
+        pos += size;
+        return v;
+    }
+
+};
+
+
+enum class MessageType : uint32_t {
+    HELLO = 1,          // worker -> server: campaign parameters and walker count
+    ASSIGN = 2,         // server -> worker: first seed of the worker's seed range and the salt of the campaign
+    REJECT = 3,         // server -> worker: reason the worker was refused
+    DP_BATCH = 4,       // worker -> server: total hash count and the DPs of one batch
+    STOP = 5            // server -> worker: a DP collided, stage 1 is over
+};
+
+constexpr uint32_t WIRE_VERSION = 3;
+constexpr std::size_t MAX_MESSAGE_SIZE = std::size_t{1} << 30;
+constexpr int HANDSHAKE_TIMEOUT_MS = 10000;     // a connection that sends no complete HELLO by then is dropped
+
+struct Message {
+    MessageType type;
+    std::vector<uint8_t> payload;
+};
+
+inline bool send_message(const Socket &socket, MessageType type, const std::vector<uint8_t> &payload) noexcept {
+    WireWriter header;
+    header.put_u32(static_cast<uint32_t>(type));
+    header.put_u32(static_cast<uint32_t>(payload.size()));
+    return payload.size() <= MAX_MESSAGE_SIZE
+        && socket.send_all(header.bytes.data(), header.bytes.size())
+        && socket.send_all(payload.data(), payload.size());
+}
+
+inline bool recv_message(const Socket &socket, Message &message) {
+    std::vector<uint8_t> header(8);
+    if (!socket.recv_all(header.data(), header.size())) {
+        return false;
+    }
+    WireReader reader(header);
+    message.type = static_cast<MessageType>(reader.get_u32());
+    const std::size_t size = reader.get_u32();
+    if (size > MAX_MESSAGE_SIZE) {
+        return false;
+    }
+    message.payload.resize(size);
+    return socket.recv_all(message.payload.data(), size);
+}
+
+/**
+ * @brief the parameters a worker and the server must agree on for their DPs to be comparable
+ */
+inline void put_campaign(WireWriter &writer, const Config &config) {
+    writer.put_u32(WIRE_VERSION);
+    writer.put_u8(static_cast<uint8_t>(config.hash_type));
+    writer.put_u16(static_cast<uint16_t>(config.collision_bits()));
+    writer.put_u16(static_cast<uint16_t>(config.dp_bits()));
+    writer.put_u16(static_cast<uint16_t>(config.prefix.size()));
+    writer.put_bytes(config.prefix.data(), config.prefix.size());
+    writer.put_u16(static_cast<uint16_t>(config.suffix.size()));
+    writer.put_bytes(config.suffix.data(), config.suffix.size());
+}
+
+/**
+ * @brief reads a campaign written by put_campaign and compares it with `config`
+ */
+inline bool campaign_matches(WireReader &reader, const Config &config) {
+    WireWriter expected;
+    put_campaign(expected, config);
+    std::vector<uint8_t> received(expected.bytes.size());
+    reader.get_bytes(received.data(), received.size());
+    return reader.ok() && received == expected.bytes;
+}
+
+/**
+ * @brief splits `HOST:PORT`
+ */
+inline bool parse_endpoint(const std::string &endpoint, std::string &host, uint16_t &port) {
+    const auto colon = endpoint.rfind(':');
+    std::size_t value = 0;
+    if (colon == std::string::npos || colon == 0 || !parse_size(std::string_view(endpoint).substr(colon + 1), value) || value == 0 || value > UINT16_MAX) {
+        return false;
+    }
+    host = endpoint.substr(0, colon);
+    port = static_cast<uint16_t>(value);
+    return true;
+}
@@ -0,0 +1,259 @@
+/**
+ * @file dp_server.hpp
+ * @author Steven
+ * @brief The DP server of a distributed VOW campaign, which merges the DP batches of its workers into its DP table and hands out seed ranges, and the connection of a worker to it
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <iostream>
+#include <deque>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "config.hpp"
+#include "checkpoint.hpp"
+#include "dp_net.hpp"
+#include "vow.hpp"
+
+/**
+ * @brief connects to the DP server and gets a seed range for `walkers` walkers and the salt of the campaign
+ * @return                  false if the server cannot be reached, rejects the campaign or walks with another salt than --salt (the reason is written to `os`)
+ */
+inline bool connect_dp_server(const Config &config, std::size_t walkers, DPUplink &uplink, std::ostream &os=std::cerr) {
+    std::string host;
+    uint16_t port = 0;
+    if (!parse_endpoint(config.server, host, port)) {
+        os << "--server expects HOST:PORT, got " << config.server << std::endl;
+        return false;
+    }
+    uplink.socket = Socket::connect(host, port);
+    if (!uplink.socket.valid()) {
+        os << "Cannot reach the DP server at " << config.server << std::endl;
+        return false;
+    }
+    WireWriter hello;
+    put_campaign(hello, config);
+    hello.put_u64(walkers);
+    Message reply;
+    if (!send_message(uplink.socket, MessageType::HELLO, hello.bytes) || !recv_message(uplink.socket, reply)) {
+        os << "Lost the DP server during the handshake" << std::endl;
+        return false;
+    }
+    WireReader reader(reply.payload);
+    if (reply.type == MessageType::REJECT) {
+        os << "The DP server rejected this worker: " << std::string(reply.payload.begin(), reply.payload.end()) << std::endl;
+        return false;
+    }
+    uplink.seed_base = reader.get_u64();
+    uplink.salt.resize(reader.get_u16());
+    reader.get_bytes(uplink.salt.data(), uplink.salt.size());
+    if (reply.type != MessageType::ASSIGN || !reader.ok()) {
+        os << "Unexpected reply from the DP server" << std::endl;
+        return false;
+    }
+    if (!config.random_salt && uplink.salt != config.salt) {
+        os << "The DP server walks with another salt than --salt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief stage 1 as the DP server of a multi-node campaign
+ * 
+ * Workers run the stage-1 pipelines on their own devices and seed ranges and stream their DPs here,
+ * one connection thread per worker merges them into the DP table. The first DP collision stops every worker.
+ */
+template <typename HASH, std::size_t N>
+std::optional<StageOneResult<HASH, N>> vow_dp_server(const Config &config, std::ostream &os=std::cout) {
+
+    const auto listener = Socket::listen(static_cast<uint16_t>(config.listen_port));
+    if (!listener.valid()) {
+        std::cerr << "Cannot listen on port " << config.listen_port << std::endl;
+        return std::nullopt;
+    }
+    os << "Allocating DP table: ";
+    StageOneShared<HASH, N> shared(config, 0, nullptr, os);
+    Checkpointer checkpoint;
+    if (!report_dp_table(shared, config, os) || !open_telemetry(shared, config) 
+        || (!config.checkpoint_dir.empty() && !open_checkpoint(checkpoint, config, shared, os))) {
+        return std::nullopt;
+    }
+    os << "DP server listening on port " << config.listen_port << std::endl;
+
+    // workers of a resumed campaign get fresh seeds, the chains of the previous workers are already in the DP table
+    std::size_t next_seed = 0;
+    std::vector<uint8_t> server_state;
+    if (config.resume && checkpoint.load("server.bin", server_state)) {
+        WireReader reader(server_state);
+        next_seed = reader.get_u64();
+        shared.resumed_hash_counts = reader.get_u64();
+    }
+    auto next_save = std::chrono::steady_clock::now() + std::chrono::seconds(config.checkpoint_interval);
+    auto save_server_state = [&] {
+        if (shared.dp_table.is_mapped()) {
+            checkpoint.call([&dp_table = shared.dp_table] { return dp_table.sync(); });
+        }
+        WireWriter writer;
+        writer.put_u64(next_seed);
+        writer.put_u64(shared.total_hash_counts());
+        checkpoint.save("server.bin", std::move(writer.bytes));
+        next_save = std::chrono::steady_clock::now() + std::chrono::seconds(config.checkpoint_interval);
+    };
+
+    // every message to a worker is sent under merge_mutex while shared.stop is unset, so none interleaves with the final STOP
+    auto reject = [&](const Socket &socket, const std::string &reason) {
+        std::lock_guard lock(shared.merge_mutex);
+        if (!shared.stop) {
+            send_message(socket, MessageType::REJECT, std::vector<uint8_t>(reason.begin(), reason.end()));
+        }
+    };
+
+    // the HELLO is read on the connection thread, with a receive timeout, so a silent connection never stalls the accept loop
+    auto handshake = [&](const Socket &socket) -> std::optional<std::size_t> {
+        Message hello;
+        socket.set_recv_timeout(HANDSHAKE_TIMEOUT_MS);
+        if (!recv_message(socket, hello) || hello.type != MessageType::HELLO) {
+            return std::nullopt;
+        }
+        socket.set_recv_timeout(0);
+        WireReader reader(hello.payload);
+        const bool matches = campaign_matches(reader, config);
+        const std::size_t walkers = reader.get_u64();
+        if (!matches || !reader.ok()) {
+            reject(socket, "campaign parameters differ from the server's");
+            return std::nullopt;
+        }
+        std::lock_guard lock(shared.merge_mutex);
+        if (shared.stop) {
+            return std::nullopt;
+        }
+        if (walkers > SIZE_MAX - next_seed) {
+            const std::string reason = "the seed space is exhausted";
+            send_message(socket, MessageType::REJECT, std::vector<uint8_t>(reason.begin(), reason.end()));
+            return std::nullopt;
+        }
+        WireWriter assign;
+        assign.put_u64(next_seed);
+        assign.put_u16(static_cast<uint16_t>(config.salt.size()));
+        assign.put_bytes(config.salt.data(), config.salt.size());
+        if (!send_message(socket, MessageType::ASSIGN, assign.bytes)) {
+            return std::nullopt;
+        }
+        const std::size_t worker = shared.hash_counts.size();
+        shared.hash_counts.push_back(0);
+        os << "Worker " << worker << " joined with " << walkers << " walkers, seeds " << next_seed << ".." << next_seed + walkers - 1 << std::endl;
+        next_seed += walkers;
+        shared.walkers += walkers;
+        if (shared.checkpoint) {
+            save_server_state();
+        }
+        return worker;
+    };
+
+    auto serve_worker = [&](Socket &socket) {
+        const auto joined = handshake(socket);
+        if (!joined) {
+            std::lock_guard lock(shared.merge_mutex);
+            socket.close();
+            return;
+        }
+        const std::size_t worker = *joined;
+        Message message;
+        auto last_merge = std::chrono::steady_clock::now();
+        for (std::size_t batch_count = 1; !shared.stop && recv_message(socket, message); ++batch_count) {
+            if (message.type != MessageType::DP_BATCH) {
+                break;
+            }
+            std::lock_guard lock(shared.merge_mutex);
+            if (shared.stop) {
+                break;
+            }
+            const std::size_t table_size = shared.dp_table.size();
+            const std::size_t robin_hoods = shared.robin_hoods;
+            std::size_t hash_counts = 0, dp_count = 0;
+            const auto merge_start = std::chrono::steady_clock::now();
+            if (!merge_dp_batch(shared, config, message.payload, hash_counts, dp_count)) {
+                break;
+            }
+            BatchStats stats;
+            stats.hashes = hash_counts - std::min(hash_counts, shared.hash_counts[worker]);
+            stats.merge = elapsed_seconds(merge_start, std::chrono::steady_clock::now());
+            stats.interval = elapsed_seconds(last_merge, merge_start);
+            last_merge = merge_start;
+            shared.hash_counts[worker] = hash_counts;
+            write_telemetry(shared, config, "worker", worker, batch_count, dp_count, stats);
+            os << std::dec << "Worker: " << worker << ",\tBatch: " << batch_count << ",\tTotal hash counts: " << shared.total_hash_counts();
+            if (shared.dp_table_full && !shared.dp_table_full_reported) {
+                os << ",\tDP table full at " << shared.dp_table.size() << " DPs (increase --dp-table-bytes)";
+                shared.dp_table_full_reported = true;
+            }
+            if (shared.robin_hoods > robin_hoods) {
+                os << ",\tRobin Hoods: " << shared.robin_hoods - robin_hoods << " (" << shared.robin_hoods << " so far, not collisions)";
+            }
+            if (shared.checkpoint) {
+                if (!shared.dp_table.is_mapped()) {
+                    shared.checkpoint->append_log(message.payload);
+                }
+                if (std::chrono::steady_clock::now() >= next_save) {
+                    save_server_state();
+                    os << (shared.checkpoint->healthy() ? ",\tcheckpoint queued" : ",\tcheckpoint writes failed");
+                }
+            }
+            if (shared.result.found) {
+                shared.stop = true;
+                break;
+            }
+            if (std::chrono::steady_clock::now() >= shared.deadline) {
+                os << ",\ttime limit reached" << std::endl;
+                shared.stop = true;
+                break;
+            }
+            os << ",\tDP chain counts: " << shared.dp_table.size() << ",\tnew DPs: " << shared.dp_table.size() - table_size;
+            if (shared.stream) {
+                os << ",\tcollisions: " << shared.stream->distinct();
+            }
+            os << std::endl;
+        }
+        std::lock_guard lock(shared.merge_mutex);
+        if (!shared.stop) {
+            os << "Worker " << worker << " disconnected" << std::endl;
+        }
+    };
+
+    std::deque<Socket> workers;             // stable addresses for the connection threads
+    std::vector<std::thread> connections;
+    while (!shared.stop) {
+        if (std::chrono::steady_clock::now() >= shared.deadline) {
+            std::lock_guard lock(shared.merge_mutex);
+            os << "Time limit reached" << std::endl;
+            shared.stop = true;
+            break;
+        }
+        auto socket = listener.accept(200);
+        if (!socket.valid()) {
+            continue;
+        }
+        workers.push_back(std::move(socket));
+        connections.emplace_back(serve_worker, std::ref(workers.back()));
+    }
+
+    {
+        std::lock_guard lock(shared.merge_mutex);
+        for (const auto &socket : workers) {
+            if (socket.valid()) {
+                send_message(socket, MessageType::STOP, {});
+                socket.shutdown();
+            }
+        }
+    }
+    for (auto &connection : connections) {
+        connection.join();
+    }
+
+    return finish_stage_one(shared, config, os);
+}
@@ -0,0 +1,460 @@
+/**
+ * @file dp_table.hpp
+ * @author Steven
+ * @brief A preallocated open-addressing hash table for distinguishable points (DPs), keyed on a run-time number of bytes and bounded by a fixed memory budget, in RAM or in a memory-mapped file, with a blocked Bloom filter in front of it
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "mapped_file.hpp"
+
+/**
+ * @brief blocked Bloom filter over key hashes: every key sets BITS_PER_KEY bits of a single 64-byte block
+ *
+ * A lookup reads one cache line, so the filter answers "certainly absent" for most new DPs
+ * without touching the (far larger, possibly memory-mapped) slots of the table behind it.
+ */
+class BlockedBloomFilter
+{
+
+public:
+
+    static constexpr std::size_t BLOCK_WORDS = 8;             // 512 bits, one cache line
+    static constexpr std::size_t BITS_PER_KEY = 6;            // about 1% false positives at 10 bits per key
+
+    BlockedBloomFilter() = default;
+
+    /**
+     * @param bits              filter size, rounded down to a power of two of blocks (at least one)
+     */
+    explicit BlockedBloomFilter(std::size_t bits) {
+        const std::size_t blocks = std::bit_floor(std::max<std::size_t>(bits / (64 * BLOCK_WORDS), 1));
+        shift = 64 - std::countr_zero(blocks);
+        words.resize(blocks * BLOCK_WORDS);
+    }
+
+    /**
+     * @brief bytes of a filter of `bits` bits
+     */
+    static std::size_t bytes_for(std::size_t bits) noexcept {
+        return std::bit_floor(std::max<std::size_t>(bits / (64 * BLOCK_WORDS), 1)) * BLOCK_WORDS * sizeof(uint64_t);
+    }
+
+    /**
+     * @param h                 uniformly distributed 64-bit key hash
+     */
+    void add(uint64_t h) noexcept {
+        uint64_t *block = words.data() + block_of(h);
+        uint64_t bits = bit_positions(h);
+        for (std::size_t i = 0; i < BITS_PER_KEY; ++i, bits >>= 9) {
+            block[(bits >> 6) & (BLOCK_WORDS - 1)] |= uint64_t{1} << (bits & 63);
+        }
+    }
+
+    /**
+     * @return                  false if no key with hash `h` was added, true if one might have been
+     */
+    bool may_contain(uint64_t h) const noexcept {
+        const uint64_t *block = words.data() + block_of(h);
+        uint64_t bits = bit_positions(h);
+        for (std::size_t i = 0; i < BITS_PER_KEY; ++i, bits >>= 9) {
+            if (!((block[(bits >> 6) & (BLOCK_WORDS - 1)] >> (bits & 63)) & 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t memory_bytes() const noexcept {
+        return words.size() * sizeof(uint64_t);
+    }
+
+private:
+
+    std::vector<uint64_t> words;
+    int shift = 64;
+
+    /**
+     * @brief first word of the block, from the high bits of a remix of `h` (the table uses the high bits of `h` itself for the slot index)
+     */
+    std::size_t block_of(uint64_t h) const noexcept {
+        const uint64_t mixed = (h ^ (h >> 31)) * 0xBF58476D1CE4E5B9ull;
+        return shift < 64 ? static_cast<std::size_t>(mixed >> shift) * BLOCK_WORDS : 0;
+    }
+
+    /**
+     * @brief BITS_PER_KEY 9-bit positions in the block, from another remix of `h`
+     */
+    static uint64_t bit_positions(uint64_t h) noexcept {
+        return (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    }
+
+};
+
+
+/**
+ * @brief open-addressing (linear probing) table of packed {key, value} slots
+ *
+ * DP keys are digest bytes, so they are already uniformly distributed and the slot index is taken from the key itself.
+ * The table never grows: its capacity is fixed by the memory budget given at construction,
+ * and inserts beyond MAX_LOAD_FACTOR are refused instead of reallocating.
+ * Slots are packed to the run-time key length, so only the `key_len` leading bytes of a KEY are stored and compared.
+ * The occupancy bitmap and the slots live in one region, either owned or borrowed (a mapped file),
+ * and a table built on a region that already holds slots continues from them.
+ * A BlockedBloomFilter of FILTER_BITS_PER_SLOT bits per slot is always kept in RAM: an insert the filter rules out
+ * goes straight to the first free slot without comparing keys, and the merge can try the possible hits of a batch first.
+ * @tparam MAX_KEY_LEN      maximum number of key bytes
+ * @tparam VALUE            trivially copyable value stored with each key
+ */
+template<std::size_t MAX_KEY_LEN, typename VALUE>
+class DPTable
+{
+    static_assert(std::is_trivially_copyable_v<VALUE>, "VALUE must be trivially copyable");
+
+public:
+
+    using KEY = std::array<uint8_t, MAX_KEY_LEN>;
+    static constexpr double MAX_LOAD_FACTOR = 0.8;
+    static constexpr std::size_t FILTER_BITS_PER_SLOT = 8;    // 10 bits per DP at the load limit
+
+    enum class Status { INSERTED, FOUND, FULL };
+
+    struct Result {
+        Status status;
+        VALUE value;            // the value already stored under the key if status is FOUND
+    };
+
+    /**
+     * @param memory_budget     upper bound on the bytes used by the slots, the occupancy bitmap and the filter
+     * @param key_len           number of key bytes (a DP's first K digest bytes are zero by definition, so N - K), at most MAX_KEY_LEN
+     */
+    DPTable(std::size_t memory_budget, std::size_t key_len) : key_len(key_len), slot_size(key_len + sizeof(VALUE)) {
+        slot_count = slot_count_for(memory_budget, key_len);
+        owned.resize((region_bytes(slot_count, key_len) + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        layout(reinterpret_cast<uint8_t *>(owned.data()));
+    }
+
+    /**
+     * @brief table on the borrowed `region` of `bytes` bytes (zeroed for an empty table), which must outlive it
+     *
+     * The filter is rebuilt from the slots already in the region.
+     */
+    DPTable(uint8_t *region, std::size_t bytes, std::size_t key_len) : key_len(key_len), slot_size(key_len + sizeof(VALUE)) {
+        slot_count = slots_in_region(bytes, key_len);
+        layout(region);
+        KEY key = {0};
+        for (std::size_t i = 0; i < slot_count; ++i) {
+            if (is_occupied(i)) {
+                std::memcpy(key.data(), slots + i * slot_size, key_len);
+                filter.add(hash(key, key_len));
+                ++count;
+            }
+        }
+    }
+
+    DPTable(DPTable &&) noexcept = default;    // moving `owned` keeps its buffer, so the pointers into it stay valid
+    DPTable(const DPTable &) = delete;
+    DPTable &operator=(const DPTable &) = delete;
+
+    /**
+     * @brief largest slot count (a power of two) whose bitmap, slots and filter fit in `bytes`
+     */
+    static std::size_t slot_count_for(std::size_t bytes, std::size_t key_len) noexcept {
+        std::size_t slots = std::bit_floor(std::max<std::size_t>(bytes * 8 / ((key_len + sizeof(VALUE)) * 8 + 1 + FILTER_BITS_PER_SLOT), 2));
+        while (slots > 2 && table_bytes(slots, key_len) > bytes) {
+            slots /= 2;
+        }
+        return slots;
+    }
+
+    /**
+     * @brief largest slot count (a power of two) whose bitmap and slots fit in a region of `bytes`
+     */
+    static std::size_t slots_in_region(std::size_t bytes, std::size_t key_len) noexcept {
+        std::size_t slots = std::bit_floor(std::max<std::size_t>(bytes * 8 / ((key_len + sizeof(VALUE)) * 8 + 1), 2));
+        while (slots > 2 && region_bytes(slots, key_len) > bytes) {
+            slots /= 2;
+        }
+        return slots;
+    }
+
+    /**
+     * @brief bytes of the bitmap and the slots of a table of `slots` slots
+     */
+    static constexpr std::size_t region_bytes(std::size_t slots, std::size_t key_len) noexcept {
+        return CEIL_WORDS(slots) * sizeof(uint64_t) + slots * (key_len + sizeof(VALUE));
+    }
+
+    /**
+     * @brief bytes of the bitmap, the slots and the filter of a table of `slots` slots
+     */
+    static std::size_t table_bytes(std::size_t slots, std::size_t key_len) noexcept {
+        return region_bytes(slots, key_len) + BlockedBloomFilter::bytes_for(slots * FILTER_BITS_PER_SLOT);
+    }
+
+    /**
+     * @brief smallest memory budget whose table holds `dp_count` DPs
+     */
+    static std::size_t bytes_for(std::size_t dp_count, std::size_t key_len) noexcept {
+        const std::size_t slots = std::bit_ceil(std::max<std::size_t>(static_cast<std::size_t>(static_cast<double>(dp_count) / MAX_LOAD_FACTOR) + 1, 2));
+        return table_bytes(slots, key_len);
+    }
+
+    /**
+     * @brief false if `key` is certainly absent (without touching the slots), true if it may be present
+     */
+    bool may_contain(const KEY &key) const noexcept {
+        return filter.may_contain(hash(key, key_len));
+    }
+
+    /**
+     * @brief inserts `value` under `key` unless the key is already present, with a single probe sequence
+     * @return                  FOUND with the stored value, INSERTED, or FULL if the key is absent and the table is at its load limit
+     */
+    Result insert_or_find(const KEY &key, const VALUE &value) noexcept {
+        const uint64_t h = hash(key, key_len);
+        const bool maybe = filter.may_contain(h);
+        for (std::size_t i = index(h);; i = (i + 1) & (slot_count - 1)) {
+            uint8_t *slot = slots + i * slot_size;
+            if (!is_occupied(i)) {
+                if (count >= max_count) {
+                    return Result{Status::FULL, value};
+                }
+                std::memcpy(slot, key.data(), key_len);
+                std::memcpy(slot + key_len, &value, sizeof(VALUE));
+                occupied[i / 64] |= uint64_t{1} << (i % 64);
+                filter.add(h);
+                ++count;
+                return Result{Status::INSERTED, value};
+            }
+            if (maybe && std::memcmp(slot, key.data(), key_len) == 0) {
+                Result result{Status::FOUND, value};
+                std::memcpy(&result.value, slot + key_len, sizeof(VALUE));
+                return result;
+            }
+        }
+    }
+
+    /**
+     * @brief replaces the value stored under `key`
+     * @return                  false if the key is absent
+     */
+    bool update(const KEY &key, const VALUE &value) noexcept {
+        for (std::size_t i = index(hash(key, key_len)); is_occupied(i); i = (i + 1) & (slot_count - 1)) {
+            uint8_t *slot = slots + i * slot_size;
+            if (std::memcmp(slot, key.data(), key_len) == 0) {
+                std::memcpy(slot + key_len, &value, sizeof(VALUE));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t size() const noexcept {
+        return count;
+    }
+
+    std::size_t capacity() const noexcept {
+        return max_count;
+    }
+
+    double load_factor() const noexcept {
+        return static_cast<double>(count) / static_cast<double>(slot_count);
+    }
+
+    /**
+     * @brief Fibonacci hashing of the leading key bytes (keeps short keys spread over the whole table)
+     *
+     * The slot index uses the high bits of the hash, ShardedDPTable picks shards from the low bits.
+     */
+    static uint64_t hash(const KEY &key, std::size_t key_len) noexcept {
+        uint64_t h = 0;
+        std::memcpy(&h, key.data(), key_len < sizeof(h) ? key_len : sizeof(h));
+        return h * 0x9E3779B97F4A7C15ull;
+    }
+
+    std::size_t memory_bytes() const noexcept {
+        return region_bytes(slot_count, key_len) + filter.memory_bytes();
+    }
+
+private:
+
+    std::vector<uint64_t> owned;            // the region of a table in RAM
+    BlockedBloomFilter filter;              // over the keys in the slots, in RAM even for a mapped table
+    uint64_t *occupied = nullptr;           // one bit per slot at the start of the region
+    uint8_t *slots = nullptr;               // packed {key, value} slots after the bitmap
+    std::size_t key_len = 0;
+    std::size_t slot_size = 0;
+    std::size_t slot_count = 0;
+    std::size_t max_count = 0;
+    std::size_t count = 0;
+    int shift = 0;
+
+    static constexpr std::size_t CEIL_WORDS(std::size_t bits) noexcept {
+        return (bits + 63) / 64;
+    }
+
+    void layout(uint8_t *region) noexcept {
+        filter = BlockedBloomFilter(slot_count * FILTER_BITS_PER_SLOT);
+        shift = 64 - std::countr_zero(slot_count);
+        max_count = static_cast<std::size_t>(static_cast<double>(slot_count) * MAX_LOAD_FACTOR);
+        occupied = reinterpret_cast<uint64_t *>(region);
+        slots = region + CEIL_WORDS(slot_count) * sizeof(uint64_t);
+    }
+
+    bool is_occupied(std::size_t i) const noexcept {
+        return (occupied[i / 64] >> (i % 64)) & 1;
+    }
+
+    std::size_t index(uint64_t h) const noexcept {
+        return static_cast<std::size_t>(h >> shift);
+    }
+
+};
+
+
+/**
+ * @brief DPTable split into independent shards by key hash, so each shard can be merged into by its own thread without locking
+ *
+ * The shards are kept in RAM, or in a file mapped into memory (a store) so the table can be larger than RAM:
+ * inserts and lookups then go straight to the mapped pages, and the file keeps every DP merged so far.
+ * A store starts with a header page, then holds the page-aligned region of every shard.
+ */
+template<std::size_t MAX_KEY_LEN, typename VALUE>
+class ShardedDPTable
+{
+
+public:
+
+    using TABLE = DPTable<MAX_KEY_LEN, VALUE>;
+    using KEY = typename TABLE::KEY;
+
+    /**
+     * @param memory_budget     total memory budget, split evenly among the shards
+     * @param shard_count       number of shards (a power of two)
+     * @param key_len           number of key bytes, see DPTable
+     */
+    ShardedDPTable(std::size_t memory_budget, std::size_t shard_count, std::size_t key_len) : key_len(key_len) {
+        shards.reserve(shard_count);
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            shards.emplace_back(memory_budget / shard_count, key_len);
+        }
+    }
+
+    /**
+     * @brief the table in the store file `path`, see valid()
+     * @param reopen            continue the DPs of an existing store (whose own size is kept), otherwise the store is created empty
+     */
+    ShardedDPTable(std::size_t memory_budget, std::size_t shard_count, std::size_t key_len, const std::string &path, bool reopen) : key_len(key_len) {
+        StoreHeader header{STORE_MAGIC, key_len, sizeof(VALUE), shard_count, 0};
+        header.shard_bytes = TABLE::region_bytes(TABLE::slot_count_for(memory_budget / shard_count, key_len), key_len);
+        header.shard_bytes = (header.shard_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        if (!file.open(path, PAGE_SIZE + shard_count * header.shard_bytes, reopen)) {
+            return;
+        }
+        if (reopen) {
+            StoreHeader stored;
+            std::memcpy(&stored, file.data(), sizeof(stored));
+            header.shard_bytes = stored.shard_bytes;
+            if (std::memcmp(&stored, &header, sizeof(header)) != 0 || file.size() != PAGE_SIZE + shard_count * stored.shard_bytes) {
+                file.close();
+                return;
+            }
+        }
+        std::memcpy(file.data(), &header, sizeof(header));
+        shards.reserve(shard_count);
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            shards.emplace_back(file.data() + PAGE_SIZE + i * header.shard_bytes, header.shard_bytes, key_len);
+        }
+    }
+
+    /**
+     * @brief false if the store could not be created or mapped, or if the reopened store was made for other keys, values or shards
+     */
+    bool valid() const noexcept {
+        return !shards.empty();
+    }
+
+    bool is_mapped() const noexcept {
+        return file.is_open();
+    }
+
+    /**
+     * @brief writes the DPs of a store back to its file (nothing to do in RAM)
+     */
+    bool sync() const noexcept {
+        return file.sync();
+    }
+
+    /**
+     * @brief smallest memory budget whose shards hold `dp_count` DPs in total
+     */
+    static std::size_t bytes_for(std::size_t dp_count, std::size_t shard_count, std::size_t key_len) noexcept {
+        return shard_count * TABLE::bytes_for((dp_count + shard_count - 1) / shard_count, key_len);
+    }
+
+    std::size_t shard_of(const KEY &key) const noexcept {
+        return static_cast<std::size_t>(TABLE::hash(key, key_len) & (shards.size() - 1));
+    }
+
+    TABLE &shard(std::size_t i) noexcept {
+        return shards[i];
+    }
+
+    std::size_t shard_count() const noexcept {
+        return shards.size();
+    }
+
+    std::size_t size() const noexcept {
+        std::size_t count = 0;
+        for (const auto &table : shards) {
+            count += table.size();
+        }
+        return count;
+    }
+
+    std::size_t capacity() const noexcept {
+        std::size_t count = 0;
+        for (const auto &table : shards) {
+            count += table.capacity();
+        }
+        return count;
+    }
+
+    std::size_t memory_bytes() const noexcept {
+        std::size_t bytes = 0;
+        for (const auto &table : shards) {
+            bytes += table.memory_bytes();
+        }
+        return bytes;
+    }
+
+private:
+
+    struct StoreHeader {
+        uint64_t magic;
+        uint64_t key_len;
+        uint64_t value_size;
+        uint64_t shard_count;
+        uint64_t shard_bytes;
+    };
+
+    static constexpr uint64_t STORE_MAGIC = 0x3154534450574F56ull;    // "VOWPDST1" read as a little-endian word
+    static constexpr std::size_t PAGE_SIZE = 4096;                      // alignment of the header and the shard regions
+
+    MappedFile file;                        // declared before the shards, which point into it
+    std::vector<TABLE> shards;
+    std::size_t key_len = 0;
+
+};
@@ -0,0 +1,407 @@
+/**
+ * @file launch.hpp
+ * @author Steven
+ * @brief Launch setup of stage 1: the --devices selection, the --autotune trial batches and the --k auto plan of the launch sizes, K and the DP table
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <optional>
+#include <vector>
+#include "sha2_simd.hpp"
+#include "config.hpp"
+#include "vow.hpp"
+
+constexpr std::array<std::size_t, 4> TUNE_WALKERS_PER_UNIT = {64, 256, 1024, 4096};    // Walker counts --autotune tries, per compute unit of the device
+constexpr std::size_t TUNE_MAX_THREADS = std::size_t{1} << 22;  // Most walkers --autotune gives one device
+constexpr std::size_t TUNE_MAX_WORK_GROUP = 1024;   // Largest work-group size --autotune tries
+constexpr double TUNE_MAX_MEMORY = 0.5;             // Share of the device memory the walker states of a trial may take
+constexpr double PLAN_MAX_DP_RATE = 1e7;            // DPs per second --k auto lets the host merge take
+constexpr double PLAN_DP_MARGIN = 2;                // DP table capacity --k auto plans per expected DP (the work to a collision varies)
+
+
+/**
+ * @brief wall time of one batch of the stage-1 kernel on the first `threads` walkers of `storage` (with the stride of `threads` walkers)
+ * @param seed              start the walkers from their seeds instead of where the last batch left them
+ */
+template <typename HASH, std::size_t N>
+double time_walk(
+    sycl::queue &q, 
+    const Walk<HASH> &walk, 
+    StateBuffers<HASH, N> states, 
+    const DPBuffer<HASH, N> &dps, 
+    const LaunchSizes &sizes, 
+    bool seed
+) {
+    states.threads = sizes.threads;
+    const auto start = std::chrono::steady_clock::now();
+    auto reset = q.memset(dps.cursor, 0, sizeof(uint32_t) * DPBuffer<HASH, N>::COUNTERS);
+    submit_walk<HASH, N>(q, walk, states, dps, sizes.batch_size, 0, sizes.work_group, {reset}, seed ? std::optional<std::size_t>{0} : std::nullopt).wait();
+    return elapsed_seconds(start, std::chrono::steady_clock::now());
+}
+
+/**
+ * @brief steps per second of the stage-1 kernel with the walkers and work-group of `sizes` (its batch size is ignored)
+ * 
+ * One untimed step from the seeds (JIT compilation, cold caches), a short probe batch, and a batch sized from the probe to last `seconds`, which is timed.
+ * @param storage           states of at least sizes.threads walkers, overwritten
+ */
+template <typename HASH, std::size_t N>
+double measure_step_rate(
+    sycl::queue &q, 
+    const Walk<HASH> &walk, 
+    const StateBuffers<HASH, N> &storage, 
+    const DPBuffer<HASH, N> &dps, 
+    LaunchSizes sizes, 
+    double seconds
+) {
+    sizes.batch_size = 1;
+    (void) time_walk(q, walk, storage, dps, sizes, true);
+    sizes.batch_size = 16;
+    const double probe = std::max(time_walk(q, walk, storage, dps, sizes, false), 1e-6);
+    sizes.batch_size = std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(sizes.batch_size) * seconds / probe));
+    const double elapsed = time_walk(q, walk, storage, dps, sizes, false);
+    return static_cast<double>(sizes.threads * sizes.batch_size) / std::max(elapsed, 1e-9);
+}
+
+
+/**
+ * @brief picks the launch sizes of the stage-1 kernel on one device with trial batches (--autotune)
+ * 
+ * Every power-of-two work-group size the device takes, and the runtime's own choice, is tried with the TUNE_WALKERS_PER_UNIT walker counts,
+ * each measured over a quarter of --tune-kernel-ms (settings whose walker states exceed TUNE_MAX_MEMORY of the device memory are skipped,
+ * and the states are allocated once for the largest setting left). The setting with the most steps per second wins, and its batch is scaled to last --tune-kernel-ms,
+ * within what the DP buffer holds at the expected DP rate.
+ */
+template <typename HASH, std::size_t N>
+LaunchSizes autotune_device(sycl::queue &q, const Config &config, const Walk<HASH> &walk, std::ostream &os) {
+    const auto device = q.get_device();
+    const std::size_t compute_units = device.get_info<sycl::info::device::max_compute_units>();
+    const std::size_t max_work_group = std::min<std::size_t>(device.get_info<sycl::info::device::max_work_group_size>(), TUNE_MAX_WORK_GROUP);
+    const double target = static_cast<double>(config.tune_kernel_ms) / 1000;
+    std::vector<std::size_t> work_groups = {0};
+    for (std::size_t work_group = 32; work_group <= max_work_group; work_group *= 2) {
+        work_groups.push_back(work_group);
+    }
+
+    // the settings to try, without those whose walker states would not fit the device (the first, smallest one is always kept)
+    const double memory = static_cast<double>(device.get_info<sycl::info::device::global_mem_size>()) * TUNE_MAX_MEMORY;
+    std::vector<LaunchSizes> candidates;
+    for (const auto per_unit : TUNE_WALKERS_PER_UNIT) {
+        for (const auto work_group : work_groups) {
+            const std::size_t granule = std::max<std::size_t>(work_group, 1) * LANES;
+            const std::size_t threads = CEIL_DIV(std::max<std::size_t>(compute_units, 1) * per_unit, granule) * granule;
+            const bool fits = threads <= TUNE_MAX_THREADS && static_cast<double>(threads * StateBuffers<HASH, N>::BYTES_PER_THREAD) <= memory;
+            if (fits || candidates.empty()) {
+                candidates.push_back({threads, 1, work_group});
+            }
+        }
+    }
+    std::size_t max_threads = 0;
+    for (const auto &sizes : candidates) {
+        max_threads = std::max(max_threads, sizes.threads);
+    }
+
+    const auto storage = StateBuffers<HASH, N>::allocate(q, max_threads);
+    const auto dps = DPBuffer<HASH, N>::allocate(q, config.dp_buffer_len);
+    LaunchSizes best;
+    double best_rate = 0;
+    for (const auto &sizes : candidates) {
+        const double rate = measure_step_rate<HASH, N>(q, walk, storage, dps, sizes, target / 4);
+        if (rate > best_rate) {
+            best_rate = rate;
+            best = sizes;
+        }
+    }
+    storage.free(q);
+    dps.free(q);
+
+    // at most half the DP buffer at the expected DP rate, so a lucky batch does not overflow it
+    const double dp_limit = std::ldexp(static_cast<double>(config.dp_buffer_len) / 2, static_cast<int>(config.dp_bits())) / static_cast<double>(best.threads);
+    best.batch_size = std::max<std::size_t>(1, static_cast<std::size_t>(std::min(best_rate / static_cast<double>(best.threads) * target, dp_limit)));
+    os << "Autotuned: " << best.threads << " walkers, " << best.batch_size << " steps per batch, work-group " 
+        << (best.work_group ? std::to_string(best.work_group) : std::string("default")) << " (" << static_cast<std::size_t>(best_rate) << " steps per second)" << std::endl;
+    return best;
+}
+
+/**
+ * @brief `config` with the launch sizes of every device in `queues` from the --tune-cache, or tuned now and added to it
+ */
+template <typename HASH, std::size_t N>
+Config autotune_devices(const Config &config, std::vector<sycl::queue> &queues, std::ostream &os) {
+    Config tuned = config;
+    tuned.threads.resize(queues.size());
+    tuned.batch_size.resize(queues.size());
+    tuned.work_group.resize(queues.size());
+    const auto walk = make_walk<HASH>(config.targets.empty() ? config : config.target(0));
+    for (std::size_t d = 0; d < queues.size(); ++d) {
+        const auto on_device = device_walk(walk, config, queues[d].get_device());
+        // the kernel and its inputs that the sizes were measured with
+        const std::string key = std::string(hash_name(config.hash_type)) + " n" + std::to_string(config.collision_bits()) + "b k" + std::to_string(config.dp_bits()) + "b" 
+            + " lanes" + std::to_string(LANES) + (on_device.paired ? " pairs " : " ") + std::to_string(config.tune_kernel_ms) + "ms " + queues[d].get_device().get_info<sycl::info::device::name>();
+        os << "Device " << d << ": ";
+        auto sizes = load_tuning(config.tune_cache, key);
+        if (sizes) {
+            os << "launch sizes from " << config.tune_cache << ": " << sizes->threads << " walkers, " << sizes->batch_size << " steps per batch, work-group " 
+                << (sizes->work_group ? std::to_string(sizes->work_group) : std::string("default")) << std::endl;
+        } else {
+            sizes = autotune_device<HASH, N>(queues[d], config, on_device, os);
+            if (!save_tuning(config.tune_cache, key, *sizes)) {
+                std::cerr << "Cannot write the autotune cache " << config.tune_cache << std::endl;
+            }
+        }
+        tuned.threads[d] = sizes->threads;
+        tuned.batch_size[d] = sizes->batch_size;
+        tuned.work_group[d] = sizes->work_group;
+    }
+    return tuned;
+}
+
+
+/**
+ * @brief steps per second of one host thread walking `lanes` walkers with the `backend` kernel, timed over at least `seconds`
+ */
+template <typename HASH>
+double host_step_rate(SIMD_BACKEND backend, const Walk<HASH> &walk, std::size_t lanes, double seconds) {
+    std::array<HASH_WORDS<HASH>, SIMD_MAX_LANES> prev{}, next{};
+    for (std::size_t l = 0; l < lanes; ++l) {
+        prev[l][0] = static_cast<typename HASH_WORDS<HASH>::value_type>(l);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t steps = 0;
+    double elapsed = 0;
+    while (elapsed < seconds) {
+        for (std::size_t i = 0; i < 64; ++i) {
+            compress_lanes<HASH>(backend, walk.message, walk.midstate, prev.data(), next.data(), lanes);
+            std::swap(prev, next);
+        }
+        steps += 64;
+        elapsed = elapsed_seconds(start, std::chrono::steady_clock::now());
+    }
+    return static_cast<double>(steps * lanes) / elapsed;
+}
+
+/**
+ * @brief hashes a campaign of `walkers` walkers with a DP every 2^dp_bits steps plans for: the expected work of its --collisions,
+ * trails still open included, or with --collisions 0 the --time-limit at `rate` hashes per second
+ */
+inline double planned_hashes(const Config &config, std::size_t walkers, std::size_t dp_bits, double rate) noexcept {
+    return config.collisions == 0 
+        ? rate * static_cast<double>(config.time_limit) 
+        : expected_vow_work(config.collision_bits(), config.collisions, walkers, dp_bits);
+}
+
+/**
+ * @brief DPs the DP table is sized for: PLAN_DP_MARGIN times the DPs of `hashes` (the work to a collision varies)
+ */
+inline std::size_t planned_dps(double hashes, std::size_t dp_bits) noexcept {
+    return std::max<std::size_t>(1, static_cast<std::size_t>(PLAN_DP_MARGIN * std::ldexp(hashes, -static_cast<int>(dp_bits))));
+}
+
+/**
+ * @brief picks K, the batch sizes, the DP buffer length and the DP table size from --dp-table-bytes and the measured step rates (--k auto)
+ * 
+ * W walkers take about expected_vow_work hashes to a collision, with about one DP distance 2^K each for the trails still open at the end,
+ * and store one DP per 2^K hashes; stage 2 then rewalks two trails of about 2^K steps on one host thread. The work and the stage-2 time grow with K
+ * and the DP table shrinks, so the plan is the smallest K in bits whose DP table (PLAN_DP_MARGIN times the expected DPs) and host DP buffers fit the budget
+ * and whose DP rate the merge keeps up with (PLAN_MAX_DP_RATE). Batches last --tune-kernel-ms at the measured rates and the DP buffers hold
+ * PLAN_BUFFER_FILL batches of DPs at 2^-K, so a device pipeline can tell a drifting DP rate from the fill of its buffers.
+ * @param host              the kernel of `--devices host`, if stage 1 runs there instead of on `queues`
+ */
+template <typename HASH, std::size_t N>
+Config plan_campaign(const Config &config, std::vector<sycl::queue> &queues, std::optional<SIMD_BACKEND> host, std::ostream &os) {
+    const auto walk = make_walk<HASH>(config.targets.empty() ? config : config.target(0));
+    const double target = static_cast<double>(config.tune_kernel_ms) / 1000;
+    const std::size_t devices = host ? 1 : queues.size();
+    std::vector<double> rates(devices);
+    double rate = 0;
+    std::size_t walkers = 0;
+    for (std::size_t d = 0; d < devices; ++d) {
+        const std::size_t threads = config.threads_of(d);
+        if (host) {
+            const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+            rates[d] = host_step_rate<HASH>(*host, walk, std::min(threads, SIMD_MAX_LANES), target / 4) 
+                * static_cast<double>(std::min(cores, CEIL_DIV(threads, SIMD_MAX_LANES)));
+        } else {
+            const auto storage = StateBuffers<HASH, N>::allocate(queues[d], threads);
+            const auto dps = DPBuffer<HASH, N>::allocate(queues[d], config.dp_buffer_len);
+            rates[d] = measure_step_rate<HASH, N>(queues[d], device_walk(walk, config, queues[d].get_device()), storage, dps, LaunchSizes{threads, 1, config.work_group_of(d)}, target / 4);
+            storage.free(queues[d]);
+            dps.free(queues[d]);
+        }
+        rate += rates[d];
+        walkers += threads;
+    }
+    // stage 2 steps both chains with the kernel of vow_stage_two, both in one call once they are aligned
+    const double stage_two_rate = host_step_rate<HASH>(chain_backend(sizeof(typename HASH_WORDS<HASH>::value_type), 2), walk, 2, target / 4);
+
+    Config planned = config;
+    planned.batch_size.resize(devices);
+    double hashes = 0;
+    std::size_t table_bytes = 0, buffer_bytes = 0;
+    bool fits = false;
+    for (std::size_t k_bits = 1; k_bits < config.collision_bits() && !fits; ++k_bits) {
+        const double distance = std::ldexp(1.0, static_cast<int>(k_bits));
+        hashes = planned_hashes(config, walkers, k_bits, rate);
+        double most = 0;
+        for (std::size_t d = 0; d < devices; ++d) {
+            const double threads = static_cast<double>(config.threads_of(d));
+            const double steps = std::min(rates[d] / threads * target, UINT32_MAX / PLAN_BUFFER_FILL * distance / threads);
+            planned.batch_size[d] = std::max<std::size_t>(1, static_cast<std::size_t>(steps));
+            most = std::max(most, threads * static_cast<double>(planned.batch_size[d]));
+        }
+        planned.k = k_bits / 8;
+        planned.k_bits = k_bits;
+        planned.dp_buffer_len = std::min<std::size_t>(UINT32_MAX, static_cast<std::size_t>(PLAN_BUFFER_FILL * most / distance) + 1024);
+        planned.expected_dps = planned_dps(hashes, k_bits);
+        table_bytes = DP_TABLE<N>::bytes_for(planned.expected_dps, config.merge_threads, N - planned.k);
+        buffer_bytes = host ? 0 : 2 * devices * planned.dp_buffer_len * sizeof(DP<N>);
+        fits = table_bytes + buffer_bytes <= config.dp_table_bytes && rate / distance <= PLAN_MAX_DP_RATE;
+    }
+    if (!fits) {
+        std::cerr << "No K below N fits --dp-table-bytes " << config.dp_table_bytes << ", planning the largest" << std::endl;
+    }
+
+    const double distance = std::ldexp(1.0, static_cast<int>(planned.k_bits));
+    os << std::dec << "Plan: K = " << planned.k_bits << " bits (one DP per 2^" << planned.k_bits << " steps)";
+    for (std::size_t d = 0; d < devices; ++d) {
+        os << ", device " << d << ": " << planned.batch_size[d] << " steps per batch at " << static_cast<std::size_t>(rates[d]) << " steps per second";
+    }
+    os << "\nPlanned memory: DP table for " << planned.expected_dps << " DPs in " << table_bytes << " bytes";
+    if (!host) {
+        os << ", DP buffers of " << planned.dp_buffer_len << " DPs in " << buffer_bytes << " bytes";
+    }
+    os << " (budget " << config.dp_table_bytes << ")" << std::endl;
+    os << "Predicted: " << static_cast<std::size_t>(hashes) << " hashes, stage 1 in " << hashes / rate << " seconds, stage 2 in " 
+        << 2 * distance / stage_two_rate << " seconds on the host" << std::endl;
+    return planned;
+}
+
+
+inline void print_device_info(std::size_t index, const sycl::device &device, std::ostream &os=std::cout) {
+    os << "Selected device " << index << ": "
+        << device.get_info<sycl::info::device::name>() << std::endl;
+}
+
+/**
+ * @brief the stage-1 devices named by --devices (empty if none match)
+ * 
+ * `gpu` takes the GPUs of the platform with the most of them only, so a GPU exposed by several backends is not used twice.
+ * `all` adds the first CPU to them, and is the CPU alone on a node without GPUs.
+ */
+inline std::vector<sycl::device> select_devices(const std::string &spec) {
+    try {
+        if (spec == "default") {
+            return {sycl::device{sycl::default_selector_v}};
+        }
+        const auto cpus = sycl::device::get_devices(sycl::info::device_type::cpu);
+        if (spec == "cpu") {
+            return cpus.empty() ? std::vector<sycl::device>{} : std::vector<sycl::device>{cpus.front()};
+        }
+        if (spec == "gpu" || spec == "all") {
+            const auto gpus = sycl::device::get_devices(sycl::info::device_type::gpu);
+            std::vector<sycl::device> devices;
+            for (const auto &gpu : gpus) {
+                const auto platform = gpu.get_platform();
+                const auto count = std::count_if(gpus.begin(), gpus.end(), [&](const sycl::device &d) { return d.get_platform() == platform; });
+                if (count > static_cast<std::ptrdiff_t>(devices.size())) {
+                    devices.clear();
+                    std::copy_if(gpus.begin(), gpus.end(), std::back_inserter(devices), [&](const sycl::device &d) { return d.get_platform() == platform; });
+                }
+            }
+            if (spec == "all" && !cpus.empty()) {
+                devices.push_back(cpus.front());
+            }
+            return devices;
+        }
+    } catch (const sycl::exception &) {
+        return {};
+    }
+    const auto all = sycl::device::get_devices();
+    std::vector<std::size_t> indices;
+    if (!parse_sizes(spec, indices, 0)) {
+        return {};
+    }
+    std::vector<sycl::device> devices;
+    for (const auto i : indices) {
+        if (i >= all.size()) {
+            return {};
+        }
+        devices.push_back(all[i]);
+    }
+    return devices;
+}
+
+inline void list_devices(std::ostream &os=std::cout) {
+    const auto all = sycl::device::get_devices();
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        os << i << ": " << all[i].get_info<sycl::info::device::name>() << std::endl;
+    }
+}
+
+inline void divider(std::ostream &os=std::cout) {
+    os << "\n\n=====================================================================" << std::endl;
+}
+
+
+/**
+ * @brief selects the --devices, creates their queues and settles the launch sizes of every device (autotuned or planned)
+ * @param queues            the queues of the devices, appended to
+ * @param total_threads     set to the walkers of all devices
+ * @param err               the reason the setup failed
+ * @return                  the configuration with the launch sizes, nothing if no device matches or the sizes do not fit
+ */
+template<typename HASH, std::size_t N>
+std::optional<Config> setup_devices(const Config &options, std::vector<sycl::queue> &queues, std::size_t &total_threads, std::ostream &os, std::ostream &err = std::cerr) {
+    const bool server = options.listen_port != 0;
+    const bool host = !server && options.devices == "host";
+    const auto devices = server || host ? std::vector<sycl::device>{} : select_devices(options.devices);
+    if (!server && !host && devices.empty()) {
+        err << "No device matches --devices " << options.devices << " (see --devices list)" << std::endl;
+        return std::nullopt;
+    }
+    if (host && !host_backend<HASH>(options)) {
+        err << "This CPU does not run the " << options.host_simd << " kernel for " << hash_name(options.hash_type) 
+            << " (sha-ni only covers sha224 and sha256)" << std::endl;
+        return std::nullopt;
+    }
+
+    divider(os);
+    for (std::size_t d = 0; d < devices.size(); ++d) {
+        // kernel and copy times of the telemetry come from event profiling
+        queues.push_back(options.telemetry.empty() ? sycl::queue(devices[d]) : sycl::queue(devices[d], sycl::property_list{sycl::property::queue::enable_profiling{}}));
+        print_device_info(d, devices[d], os);
+    }
+    if (host) {
+        os << "Selected device 0: host CPU, " << simd_backend_name(*host_backend<HASH>(options)) << " kernel" << std::endl;
+    }
+    // the tuned sizes are known before the walker count is sent to a DP server
+    Config config = options.autotune && !queues.empty() ? autotune_devices<HASH, N>(options, queues, os) : options;
+    if (config.plan) {
+        config = plan_campaign<HASH, N>(config, queues, host ? host_backend<HASH>(options) : std::nullopt, os);
+    }
+
+    total_threads = host ? config.threads_of(0) : 0;
+    for (std::size_t d = 0; d < devices.size(); ++d) {
+        if (config.threads_of(d) % LANES != 0) {
+            err << "--threads (" << config.threads_of(d) << ") must be a multiple of LANES (" << LANES << ")" << std::endl;
+            return std::nullopt;
+        }
+        const std::size_t work_group = config.work_group_of(d);
+        if (work_group > 0 && (config.threads_of(d) / LANES % work_group != 0 || work_group > devices[d].get_info<sycl::info::device::max_work_group_size>())) {
+            err << "--work-group (" << work_group << ") must divide --threads / LANES (" << config.threads_of(d) / LANES 
+                << ") and fit the work-groups of device " << d << std::endl;
+            return std::nullopt;
+        }
+        total_threads += config.threads_of(d);
+    }
+    return config;
+}
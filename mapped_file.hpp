@@ -0,0 +1,175 @@
+/**
+ * @file mapped_file.hpp
+ * @author Steven
+ * @brief Owning, move-only shared memory mapping of a whole file (backs the DP table with disk pages when it does not fit in RAM)
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+class MappedFile
+{
+
+public:
+
+    MappedFile() noexcept = default;
+    MappedFile(MappedFile &&other) noexcept {
+        swap(other);
+    }
+    MappedFile &operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() {
+        close();
+    }
+
+    /**
+     * @brief maps `path` read-write, creating it or resetting it to `size` zero bytes unless `keep` is set
+     * @param keep              map the file as it is (its size is taken from the file and `size` is ignored)
+     * @return                  false if the file cannot be opened, sized or mapped
+     */
+    bool open(const std::string &path, std::size_t size, bool keep) noexcept {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, keep ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (keep) {
+            if (!GetFileSizeEx(file, &file_size)) {
+                close();
+                return false;
+            }
+            size = static_cast<std::size_t>(file_size.QuadPart);
+        }
+        file_size.QuadPart = static_cast<LONGLONG>(size);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(file_size.QuadPart >> 32), static_cast<DWORD>(file_size.QuadPart), nullptr);
+        bytes = mapping ? static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size)) : nullptr;
+#else
+        fd = ::open(path.c_str(), keep ? O_RDWR : O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (keep) {
+            if (fstat(fd, &info) != 0) {
+                close();
+                return false;
+            }
+            size = static_cast<std::size_t>(info.st_size);
+        } else if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close();
+            return false;
+        }
+        void *address = size > 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        bytes = address != MAP_FAILED ? static_cast<uint8_t *>(address) : nullptr;
+#endif
+        if (!bytes) {
+            close();
+            return false;
+        }
+        length = size;
+        return true;
+    }
+
+    /**
+     * @brief writes the dirty pages back to the file and waits for them
+     */
+    bool sync() const noexcept {
+        if (!bytes) {
+            return true;
+        }
+#ifdef _WIN32
+        return FlushViewOfFile(bytes, 0) && FlushFileBuffers(file);
+#else
+        return msync(bytes, length, MS_SYNC) == 0;
+#endif
+    }
+
+    uint8_t *data() const noexcept {
+        return bytes;
+    }
+
+    std::size_t size() const noexcept {
+        return length;
+    }
+
+    bool is_open() const noexcept {
+        return bytes != nullptr;
+    }
+
+    void close() noexcept {
+#ifdef _WIN32
+        if (bytes) {
+            UnmapViewOfFile(bytes);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) {
+            munmap(bytes, length);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+private:
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint8_t *bytes = nullptr;
+    std::size_t length = 0;
+
+    void swap(MappedFile &other) noexcept {
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#else
+        std::swap(fd, other.fd);
+#endif
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+    }
+
+};
@@ -0,0 +1,320 @@
+/**
+ * @file searcher.hpp
+ * @author Steven
+ * @brief Library interface to the VOW partial collision search: a CollisionSearcher keeps its devices, queues, walker and DP buffers and prebuilt kernels across many searches and answers them through futures
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "vow.hpp"
+#include "launch.hpp"
+#include "stage_two.hpp"
+
+/**
+ * @brief what changes from one search to the next: the fixed bytes around the variable middle
+ */
+struct SearchParams {
+    std::vector<uint8_t> prefix;
+    std::vector<uint8_t> suffix;
+};
+
+/**
+ * @brief the outcome of one search
+ */
+struct SearchResult {
+    bool found = false;                     // the inputs below collide on the first --n (or --n-bits) digest bits
+    std::vector<uint8_t> x;                 // the two colliding inputs, prefix || middle || suffix
+    std::vector<uint8_t> y;
+    std::size_t matched_bits = 0;           // leading bits the full digests of x and y have in common
+    std::size_t hash_counts = 0;            // stage 1 and stage 2
+    double seconds = 0;
+};
+
+/**
+ * @brief stage-1 and seed kernels one device runs, for get_kernel_bundle
+ */
+template <typename HASH, std::size_t N, bool PAIRED>
+std::vector<sycl::kernel_id> walk_kernel_ids(bool work_groups) {
+    if (work_groups) {
+        return {sycl::get_kernel_id<WorkGroupKernel<StageOneKernel<HASH, N, PAIRED>>>(), sycl::get_kernel_id<WorkGroupKernel<StageOneSeedKernel<HASH, N, PAIRED>>>()};
+    }
+    return {sycl::get_kernel_id<StageOneKernel<HASH, N, PAIRED>>(), sycl::get_kernel_id<StageOneSeedKernel<HASH, N, PAIRED>>()};
+}
+
+/**
+ * @brief stage-1 kernels of one walk layout on every device, built from the input bundles before their first batch
+ */
+template <typename HASH>
+std::vector<sycl::kernel_bundle<sycl::bundle_state::executable>> build_walk_kernels(
+    const std::vector<sycl::kernel_bundle<sycl::bundle_state::input>> &inputs, const std::vector<Walk<HASH>> &walks
+) {
+    std::vector<sycl::kernel_bundle<sycl::bundle_state::executable>> kernels;
+    for (std::size_t d = 0; d < inputs.size(); ++d) {
+        auto input = inputs[d];
+        set_walk_constants(input, walks[d]);
+        kernels.push_back(sycl::build(input));
+    }
+    return kernels;
+}
+
+/**
+ * @brief partial collisions of the first N digest bytes of HASH, searched one after the other on devices set up once
+ *
+ * The constructor does what every campaign of the command line pays for again: it selects the devices and creates their queues,
+ * autotunes or plans the launch sizes if asked to, allocates the walker states and the device and host DP buffers of every device,
+ * gets the input kernel bundles of the stage-1 kernels for every device, then builds them for the layout of `options` and runs
+ * two empty batches with them. Each search then only allocates a DP table sized for it (from the expected work, unless --expected-dps is given)
+ * and runs stage 1 and stage 2 like a campaign. Searches are queued and run by one worker thread in the order they were made, since they share the devices.
+ * The prefix, suffix and salt are specialization constants of the kernels, so a layout needs kernels of its own:
+ * a search builds them (in the background, while the searches queued before it run) as soon as it is queued,
+ * and the kernels of the last MAX_BUILT_LAYOUTS layouts are kept, so repeating a layout builds nothing.
+ * The salt is part of the layout too, so --salt random draws it once for the searcher rather than once per search.
+ * @tparam HASH             hash function of the SHA-2 family, as given to main (the walk hash follows TRUNCATE)
+ * @tparam N                collision length in bytes, one of SUPPORTED_N
+ */
+template <typename HASH, std::size_t N>
+class CollisionSearcher
+{
+
+public:
+
+    using WALK = WALK_HASH<HASH, N>;
+    using KERNELS = std::vector<sycl::kernel_bundle<sycl::bundle_state::executable>>;
+
+    static constexpr std::size_t MAX_BUILT_LAYOUTS = 16;     // layouts whose kernels are kept for later searches
+
+    /**
+     * @param options           the campaign settings every search uses (--hash must name HASH and --n must be N);
+     *                          continuous mode, checkpoints, the DP store, --targets and the DP server and worker modes are not supported
+     * @param log               progress of the setup and of every search
+     */
+    CollisionSearcher(const Config &options, std::ostream &log): log{log} {
+        if (options.n != N || options.continuous() || !options.checkpoint_dir.empty() || !options.dp_store.empty()
+            || !options.targets.empty() || options.listen_port != 0 || !options.server.empty()) {
+            log << "A CollisionSearcher needs --n " << N << " and no continuous mode, checkpoint, DP store, targets, DP server or worker" << std::endl;
+            return;
+        }
+        std::size_t total_threads = 0;
+        auto setup = setup_devices<WALK, N>(options, queues, total_threads, log, log);
+        if (!setup) {
+            return;
+        }
+        config = *setup;
+        if (config.random_salt) {
+            config.salt = draw_salt(N);
+        }
+        if (config.expected_dps == 0) {
+            config.expected_dps = expected_dps(config, std::max<std::size_t>(queues.size(), 1), total_threads);
+        }
+
+        const auto walk = make_walk<WALK>(config);
+        for (std::size_t d = 0; d < queues.size(); ++d) {
+            buffers.push_back(PipelineBuffers<WALK, N>::allocate(queues[d], config.threads_of(d), config.dp_buffer_len));
+            const bool work_groups = config.work_group_of(d) > 0;
+            auto ids = walk_kernel_ids<WALK, N, false>(work_groups);
+            if constexpr (sizeof(typename HASH_WORDS<WALK>::value_type) == 8) {
+                if (device_walk(walk, config, queues[d].get_device()).paired) {
+                    ids = walk_kernel_ids<WALK, N, true>(work_groups);
+                }
+            }
+            inputs.push_back(sycl::get_kernel_bundle<sycl::bundle_state::input>(queues[d].get_context(), {queues[d].get_device()}, ids));
+        }
+        std::unique_lock lock(mutex);
+        const auto layout_kernels = kernels_for(config);
+        lock.unlock();
+        const auto &kernels = layout_kernels.get();
+        for (std::size_t d = 0; d < queues.size(); ++d) {
+            // the first batch of a search seeds the walkers, the others continue them
+            const auto on_device = device_walk(walk, config, queues[d].get_device());
+            const auto &states = buffers[d].states;
+            const auto &dps = buffers[d].device_dps[0];
+            submit_walk<WALK, N>(queues[d], on_device, states, dps, 0, 0, config.work_group_of(d), {}, 0, &kernels[d]).wait();
+            submit_walk<WALK, N>(queues[d], on_device, states, dps, 0, 0, config.work_group_of(d), {}, std::nullopt, &kernels[d]).wait();
+        }
+        ready = true;
+        worker = std::thread([this] { work(); });
+    }
+
+    /**
+     * @brief runs the searches still queued, then frees the buffers
+     */
+    ~CollisionSearcher() {
+        if (worker.joinable()) {
+            {
+                std::lock_guard lock(mutex);
+                closing = true;
+            }
+            cv.notify_one();
+            worker.join();
+        }
+        for (std::size_t d = 0; d < buffers.size(); ++d) {
+            buffers[d].free(queues[d]);
+        }
+    }
+
+    CollisionSearcher(const CollisionSearcher &) = delete;
+    CollisionSearcher &operator=(const CollisionSearcher &) = delete;
+
+    /**
+     * @brief false if the options or the devices did not fit (the reason was written to the log), every search then fails
+     */
+    bool valid() const noexcept {
+        return ready;
+    }
+
+    /**
+     * @brief the configuration the searches run with, including the tuned or planned launch sizes
+     */
+    const Config &settings() const noexcept {
+        return config;
+    }
+
+    /**
+     * @brief queues a search for a partial collision of prefix || middle || suffix and starts building its kernels
+     * @return                  the result once the search ran, not found if it could not (the reason is written to the log)
+     */
+    std::future<SearchResult> search(const SearchParams &params) {
+        std::promise<SearchResult> promise;
+        auto result = promise.get_future();
+        if (!ready) {
+            promise.set_value(SearchResult{});
+            return result;
+        }
+        const Config campaign = search_config(params);
+        if (!walk_fits<WALK>(campaign)) {
+            log << "Prefix tail, N and suffix do not fit in " << MAX_TAIL_BLOCKS << " blocks of " << WALK::BLOCK_SIZE << " bytes" << std::endl;
+            promise.set_value(SearchResult{});
+            return result;
+        }
+        {
+            std::lock_guard lock(mutex);
+            pending.push_back(Search{campaign, kernels_for(campaign), std::move(promise)});
+        }
+        cv.notify_one();
+        return result;
+    }
+
+private:
+
+    struct Search {
+        Config campaign;
+        std::shared_future<KERNELS> kernels;
+        std::promise<SearchResult> promise;
+    };
+
+    Config config;
+    std::ostream &log;
+    std::vector<sycl::queue> queues;
+    std::vector<PipelineBuffers<WALK, N>> buffers;
+    std::vector<sycl::kernel_bundle<sycl::bundle_state::input>> inputs;      // stage-1 kernels of every device, before their constants are set
+    std::map<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>, std::shared_future<KERNELS>> built;      // kernels per (prefix, suffix), guarded by `mutex`
+    std::deque<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> built_order;     // the layouts of `built`, oldest first
+    bool ready = false;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Search> pending;
+    bool closing = false;
+    std::thread worker;                     // joined by the destructor before the members it uses go
+
+    /**
+     * @brief the planned DPs of a search (see planned_dps), with two batches of every device on top
+     */
+    static std::size_t expected_dps(const Config &config, std::size_t devices, std::size_t total_threads) {
+        double hashes = planned_hashes(config, total_threads, config.dp_bits(), 0);
+        for (std::size_t d = 0; d < devices; ++d) {
+            hashes += 2.0 * static_cast<double>(config.threads_of(d) * config.batch_size_of(d));
+        }
+        return planned_dps(hashes, config.dp_bits());
+    }
+
+    Config search_config(const SearchParams &params) const {
+        Config campaign = config;
+        campaign.prefix = params.prefix;
+        campaign.suffix = params.suffix;
+        return campaign;
+    }
+
+    /**
+     * @brief the walk of every device, with the word pairs each one runs
+     */
+    std::vector<Walk<WALK>> device_walks(const Walk<WALK> &walk) const {
+        std::vector<Walk<WALK>> walks;
+        for (const auto &q : queues) {
+            walks.push_back(device_walk(walk, config, q.get_device()));
+        }
+        return walks;
+    }
+
+    /**
+     * @brief the kernels of the layout of `campaign`, built on a thread of their own unless a search already built them
+     * @pre `mutex` is held
+     */
+    std::shared_future<KERNELS> kernels_for(const Config &campaign) {
+        auto layout = std::pair{campaign.prefix, campaign.suffix};
+        if (const auto it = built.find(layout); it != built.end()) {
+            return it->second;
+        }
+        if (built_order.size() >= MAX_BUILT_LAYOUTS) {
+            built.erase(built_order.front());
+            built_order.pop_front();
+        }
+        auto kernels = std::async(std::launch::async, [this, walks = device_walks(make_walk<WALK>(campaign))] {
+            return build_walk_kernels<WALK>(inputs, walks);
+        }).share();
+        built.emplace(layout, kernels);
+        built_order.push_back(std::move(layout));
+        return kernels;
+    }
+
+    void work() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return closing || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            auto search = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+            search.promise.set_value(run(search.campaign, search.kernels.get()));
+            lock.lock();
+        }
+    }
+
+    /**
+     * @brief one search: stage 1 on the preallocated buffers with the kernels built for its layout, then stage 2
+     */
+    SearchResult run(const Config &campaign, const KERNELS &kernels) {
+        SearchResult result;
+        const auto walk = make_walk<WALK>(campaign);
+        auto walking = buffers;
+        for (std::size_t d = 0; d < walking.size(); ++d) {
+            walking[d].kernels = &kernels[d];
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const auto stage_one = vow_stage_one<WALK, N>(queues, campaign, walk, nullptr, log, &walking);
+        if (!stage_one || !stage_one->found) {
+            return result;
+        }
+        std::size_t stage_two_hash_counts = 0;
+        const auto [x_state, y_state] = run_stage_two<WALK, N>(campaign, walk, *stage_one, stage_two_hash_counts, log);
+        result.found = x_state == y_state && x_state.in != y_state.in;
+        result.x = x_state.in;
+        result.y = y_state.in;
+        result.matched_bits = matched_bits(full_digest<WALK>(x_state.in), full_digest<WALK>(y_state.in));
+        result.hash_counts = stage_one->total_hash_counts + stage_two_hash_counts;
+        result.seconds = elapsed_seconds(start, std::chrono::steady_clock::now());
+        return result;
+    }
+
+};
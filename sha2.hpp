@@ -7,6 +7,8 @@
  * @see https://nvlpubs.nist.gov/nistpubs/FIPS/NIST.FIPS.180-4.pdf
  */
 
+#pragma once
+
 #include <cstddef>
 #include <array>
 
@@ -20,6 +22,77 @@ constexpr T rotate_right(T a, uint8_t n) noexcept {
     return (a >> n) | (a << (sizeof(T) * 8 - n));
 }
 
+/**
+ * @brief a 64-bit word as two 32-bit halves, for the SHA-512 family on devices that emulate 64-bit integer arithmetic
+ * 
+ * Additions propagate the carry of the low halves by hand, and shifts and rotations move bits across the halves with 32-bit shifts only.
+ * The shift and rotate amounts of SHA-512 are constants, so every test on them folds away.
+ */
+struct Word64Pair {
+    uint32_t hi = 0;
+    uint32_t lo = 0;
+
+    constexpr Word64Pair() noexcept = default;
+    constexpr Word64Pair(uint64_t v) noexcept: hi{static_cast<uint32_t>(v >> 32)}, lo{static_cast<uint32_t>(v)} {}
+    constexpr Word64Pair(uint32_t hi, uint32_t lo) noexcept: hi{hi}, lo{lo} {}
+
+    explicit constexpr operator uint64_t() const noexcept {
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+
+    friend constexpr Word64Pair operator+(const Word64Pair a, const Word64Pair b) noexcept {
+        const uint32_t lo = a.lo + b.lo;
+        return {a.hi + b.hi + static_cast<uint32_t>(lo < a.lo), lo};
+    }
+    friend constexpr Word64Pair operator^(const Word64Pair a, const Word64Pair b) noexcept {
+        return {a.hi ^ b.hi, a.lo ^ b.lo};
+    }
+    friend constexpr Word64Pair operator&(const Word64Pair a, const Word64Pair b) noexcept {
+        return {a.hi & b.hi, a.lo & b.lo};
+    }
+    friend constexpr Word64Pair operator|(const Word64Pair a, const Word64Pair b) noexcept {
+        return {a.hi | b.hi, a.lo | b.lo};
+    }
+    constexpr Word64Pair operator~() const noexcept {
+        return {~hi, ~lo};
+    }
+    constexpr Word64Pair operator>>(const unsigned n) const noexcept {
+        if (n >= 32) {
+            return {0, hi >> (n - 32)};
+        }
+        return n == 0 ? *this : Word64Pair{hi >> n, (lo >> n) | (hi << (32 - n))};
+    }
+    constexpr Word64Pair operator<<(const unsigned n) const noexcept {
+        if (n >= 32) {
+            return {lo << (n - 32), 0};
+        }
+        return n == 0 ? *this : Word64Pair{(hi << n) | (lo >> (32 - n)), lo << n};
+    }
+    constexpr Word64Pair &operator+=(const Word64Pair b) noexcept {
+        return *this = *this + b;
+    }
+    constexpr Word64Pair &operator|=(const Word64Pair b) noexcept {
+        return *this = *this | b;
+    }
+    constexpr Word64Pair &operator^=(const Word64Pair b) noexcept {
+        return *this = *this ^ b;
+    }
+};
+
+/**
+ * @brief a rotation by 32 or more swaps the halves first, the rest shifts each half and takes the bits shifted out of the other
+ */
+constexpr Word64Pair rotate_right(Word64Pair a, uint8_t n) noexcept {
+    if (n >= 32) {
+        a = {a.lo, a.hi};
+        n -= 32;
+    }
+    if (n == 0) {
+        return a;
+    }
+    return {(a.hi >> n) | (a.lo << (32 - n)), (a.lo >> n) | (a.hi << (32 - n))};
+}
+
 
 template<typename block_t, std::size_t BLOCK_LEN = 8>
 constexpr static std::array<block_t, BLOCK_LEN> message_to_blocks(const uint8_t *message) noexcept {
@@ -69,17 +142,22 @@ constexpr std::array<uint32_t, 64>_ROUND_CONSTANTS_256{
     0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 
     0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
-constexpr uint64_t _sigma_0_512(uint64_t x) noexcept {
+// uint64_t, or Word64Pair on devices with weak 64-bit integers
+template<typename word64_t>
+constexpr word64_t _sigma_0_512(word64_t x) noexcept {
     return rotate_right(x, static_cast<uint64_t>(1)) ^ rotate_right(x, static_cast<uint64_t>(8)) ^ (x >> 7);
 }
-constexpr uint64_t _sigma_1_512(uint64_t x) noexcept {
+template<typename word64_t>
+constexpr word64_t _sigma_1_512(word64_t x) noexcept {
     return rotate_right(x, static_cast<uint64_t>(19)) ^ rotate_right(x, static_cast<uint64_t>(61)) ^ (x >> 6);
 }
-constexpr uint64_t _big_sigma_0_512(uint64_t x) noexcept {
+template<typename word64_t>
+constexpr word64_t _big_sigma_0_512(word64_t x) noexcept {
     return rotate_right(x, static_cast<uint64_t>(28)) ^ rotate_right(x, static_cast<uint64_t>(34)) 
         ^ rotate_right(x, static_cast<uint64_t>(39));
 }
-constexpr uint64_t _big_sigma_1_512(uint64_t x) noexcept {
+template<typename word64_t>
+constexpr word64_t _big_sigma_1_512(word64_t x) noexcept {
     return rotate_right(x, static_cast<uint64_t>(14)) ^ rotate_right(x,
         static_cast<uint64_t>(18)) ^ rotate_right(x, static_cast<uint64_t>(41));
 }
@@ -114,6 +192,195 @@ constexpr std::array<uint64_t, 80>_ROUND_CONSTANTS_512 = {
 
 
 
+template<typename word_t>
+constexpr word_t _sha2_schedule_word(const word_t w2, const word_t w7, const word_t w15, const word_t w16) noexcept {
+    if constexpr (sizeof(word_t) == 4) {
+        return _sigma_1_256(w2) + w7 + _sigma_0_256(w15) + w16;
+    } else if constexpr (sizeof(word_t) == 8) {
+        return _sigma_1_512(w2) + w7 + _sigma_0_512(w15) + w16;
+    } else {
+        static_assert(false, "BAD word_t");
+    }
+}
+
+/**
+ * @brief one SHA-2 round on the working variables
+ * @param s                 working variables a..h
+ * @param kw                round constant plus message schedule word of this round
+ */
+template<typename word_t>
+constexpr void _sha2_round(std::array<word_t, 8> &s, const word_t kw) noexcept {
+    word_t t1 = 0, t2 = 0;
+    if constexpr (sizeof(word_t) == 4) {
+        t1 = s[7] + _big_sigma_1_256(s[4]) + _SHA_CH(s[4], s[5], s[6]) + kw;
+        t2 = _big_sigma_0_256(s[0]) + _SHA_MAJ(s[0], s[1], s[2]);
+    } else if constexpr (sizeof(word_t) == 8) {
+        t1 = s[7] + _big_sigma_1_512(s[4]) + _SHA_CH(s[4], s[5], s[6]) + kw;
+        t2 = _big_sigma_0_512(s[0]) + _SHA_MAJ(s[0], s[1], s[2]);
+    } else {
+        static_assert(false, "BAD word_t");
+    }
+    s[7] = s[6];
+    s[6] = s[5];
+    s[5] = s[4];
+    s[4] = s[3] + t1;
+    s[3] = s[2];
+    s[2] = s[1];
+    s[1] = s[0];
+    s[0] = t1 + t2;
+}
+
+template<typename word_t>
+constexpr word_t _sha2_round_constant(const std::size_t i) noexcept {
+    if constexpr (sizeof(word_t) == 4) {
+        return _ROUND_CONSTANTS_256[i];
+    } else {
+        return _ROUND_CONSTANTS_512[i];
+    }
+}
+
+/**
+ * @brief reads sizeof(word_t) bytes at byte offset `off` of the big-endian serialisation of `v` (bytes outside of `v` read as zero)
+ */
+template<typename word_t>
+constexpr word_t _sha2_stream_word(const std::array<word_t, 8> &v, const std::ptrdiff_t off) noexcept {
+    constexpr std::ptrdiff_t W = sizeof(word_t);
+    if (off <= -W || off >= 8 * W) {
+        return 0;
+    }
+    if (off < 0) {
+        return v[0] >> (8 * -off);
+    }
+    const auto q = off / W, r = off % W;
+    if (r == 0) {
+        return v[q];
+    }
+    const word_t lo = q + 1 < 8 ? v[q + 1] >> (8 * (W - r)) : 0;
+    return (v[q] << (8 * r)) | lo;
+}
+
+
+/**
+ * @brief layout of the padded tail `prefix || L variable bytes || suffix` of a message whose first `offset` bytes are already compressed
+ * 
+ * The padding, the length word and the constant message words are folded into the message schedule,
+ * and for a whole message (offset 0) the rounds before the first variable schedule word are precomputed.
+ * The layout is built at compile time by compress_fixed and compress_midstate, 
+ * or at run time, e.g. to hand it to a kernel as a specialization constant.
+ * @tparam word_t           SHA-2 word type
+ * @tparam T                number of rounds
+ * @tparam MAX_BLOCKS       capacity of the layout in blocks of the padded tail
+ */
+template<typename word_t, std::size_t T, std::size_t MAX_BLOCKS>
+struct FixedMessage {
+    static constexpr std::size_t W = sizeof(word_t);
+    static constexpr std::size_t B = 16 * W;
+
+    struct Block {
+        std::array<word_t, T> w{};                  // constant schedule words, or the constant part of variable ones
+        std::array<word_t, 16> mask{};              // bits of the message words holding variable bytes
+        std::array<bool, T> is_const{};             // schedule word depends on constant bytes only
+        std::array<std::array<bool, 4>, T> var_term{};  // variable terms of w[i-2], w[i-7], w[i-15], w[i-16]
+        std::size_t first_var = 0;                  // rounds before this one are folded into `state`
+        std::array<word_t, 8> state{};              // working variables entering round `first_var`
+    };
+    std::size_t block_count = 0;
+    std::size_t prefix_len = 0;
+    std::size_t offset = 0;
+    std::array<Block, MAX_BLOCKS> blocks{};
+
+    /**
+     * @brief number of blocks of the padded tail of `tail_len` bytes
+     */
+    static constexpr std::size_t blocks_for(const std::size_t tail_len) noexcept {
+        return CEIL_DIV(tail_len + 1 + B / 8, B);
+    }
+
+    static constexpr bool fits(const std::size_t prefix_len, const std::size_t L, const std::size_t suffix_len) noexcept {
+        return blocks_for(prefix_len + L + suffix_len) <= MAX_BLOCKS;
+    }
+
+    constexpr FixedMessage() noexcept = default;
+
+    /**
+     * @pre fits(prefix_len, L, suffix_len) and offset is a multiple of the block size
+     * @param init              initial hash value of the SHA-2 function, the chaining value of block 0 if offset is 0
+     * @param prefix            constant bytes before the variable bytes
+     * @param L                 number of variable bytes, taken from the start of the previous digest
+     * @param suffix            constant bytes after the variable bytes
+     * @param offset            bytes compressed before the tail
+     * @param last_mask         bits of the last variable byte taken from the digest, the others are zero (a bit-granular L)
+     * @param salt              L bytes XORed into the variable bytes (masked like them), kept in the constant part of their words (nullptr: none)
+     */
+    constexpr FixedMessage(
+        const std::array<word_t, 8> &init,
+        const uint8_t *prefix, const std::size_t prefix_len,
+        const std::size_t L,
+        const uint8_t *suffix, const std::size_t suffix_len,
+        const std::size_t offset,
+        const uint8_t last_mask = 0xFF,
+        const uint8_t *salt = nullptr
+    ) noexcept : prefix_len(prefix_len), offset(offset)
+    {
+        const std::size_t tail = prefix_len + L + suffix_len;
+        block_count = blocks_for(tail);
+        std::array<uint8_t, MAX_BLOCKS * B> bytes{};
+        for (std::size_t i = 0; i < prefix_len; ++i) {
+            bytes[i] = prefix[i];
+        }
+        for (std::size_t i = 0; salt && i < L; ++i) {
+            bytes[prefix_len + i] = i + 1 == L ? salt[i] & last_mask : salt[i];
+        }
+        for (std::size_t i = 0; i < suffix_len; ++i) {
+            bytes[prefix_len + L + i] = suffix[i];
+        }
+        bytes[tail] = 0x80;
+        const uint64_t len_bits = (offset + tail) * 8;
+        for (std::size_t i = 0; i < 8; ++i) {
+            bytes[block_count * B - 1 - i] = (len_bits >> (8 * i)) & 0xFF;
+        }
+        for (std::size_t j = 0; j < block_count; ++j) {
+            auto &blk = blocks[j];
+            for (std::size_t i = 0; i < 16; ++i) {
+                for (std::size_t k = 0; k < W; ++k) {
+                    blk.w[i] = (blk.w[i] << 8) | bytes[j * B + i * W + k];
+                }
+            }
+            for (std::size_t p = prefix_len; p < prefix_len + L; ++p) {
+                if (p / B == j) {
+                    const word_t byte_mask = p + 1 == prefix_len + L ? last_mask : 0xFF;
+                    blk.mask[p % B / W] |= byte_mask << (8 * (W - 1 - p % W));
+                }
+            }
+            for (std::size_t i = 0; i < 16; ++i) {
+                blk.is_const[i] = blk.mask[i] == 0;
+            }
+            for (std::size_t i = 16; i < T; ++i) {
+                const std::array<std::size_t, 4> src = {i - 2, i - 7, i - 15, i - 16};
+                blk.is_const[i] = true;
+                for (std::size_t t = 0; t < 4; ++t) {
+                    blk.var_term[i][t] = !blk.is_const[src[t]];
+                    blk.is_const[i] = blk.is_const[i] && blk.is_const[src[t]];
+                }
+                // sigma(0) == 0, so zeroing the variable terms leaves the constant part
+                blk.w[i] = _sha2_schedule_word<word_t>(
+                    blk.var_term[i][0] ? 0 : blk.w[src[0]], blk.var_term[i][1] ? 0 : blk.w[src[1]],
+                    blk.var_term[i][2] ? 0 : blk.w[src[2]], blk.var_term[i][3] ? 0 : blk.w[src[3]]
+                );
+            }
+            // only the first block of a whole message starts from a known chaining value
+            blk.state = init;
+            if (j == 0 && offset == 0) {
+                while (blk.first_var < T && blk.is_const[blk.first_var]) {
+                    _sha2_round<word_t>(blk.state, _sha2_round_constant<word_t>(blk.first_var) + blk.w[blk.first_var]);
+                    ++blk.first_var;
+                }
+            }
+        }
+    }
+};
+
+
 template<
     std::size_t N, 
     std::size_t M, 
@@ -166,83 +433,221 @@ private:
     {
         std::array<word_t, T> w = {0};
         std::copy(msg_block.cbegin(), msg_block.cend(), w.begin());
-        word_t a = hash_val[0], b = hash_val[1], c = hash_val[2], d = hash_val[3],
-            e = hash_val[4], f = hash_val[5], g = hash_val[6], h = hash_val[7];
+        std::array<word_t, 8> s = hash_val;
         for (decltype(T) i = 16; i < T; ++i) {
-            if constexpr (N == 32) {
-                w[i] = _sigma_1_256(w[i-2]) + w[i-7] + _sigma_0_256(w[i-15]) + w[i-16];
-            } else if constexpr (N == 64) {
-                w[i] = _sigma_1_512(w[i-2]) + w[i-7] + _sigma_0_512(w[i-15]) + w[i-16];
-            } else {
-                static_assert(false, "BAD N");
-            }
+            w[i] = _sha2_schedule_word<word_t>(w[i-2], w[i-7], w[i-15], w[i-16]);
         }
         for (decltype(T) i = 0; i < T; ++i) {
-            word_t t1 = 0, t2 = 0;
-            if constexpr (N == 32) {
-                t1 = h + _big_sigma_1_256(e) + _SHA_CH(e, f, g) + _ROUND_CONSTANTS_256[i] + w[i];
-                t2 = _big_sigma_0_256(a) + _SHA_MAJ(a, b, c);
-            } else if constexpr (N == 64) {
-                t1 = h + _big_sigma_1_512(e) + _SHA_CH(e, f, g) + _ROUND_CONSTANTS_512[i] + w[i];
-                t2 = _big_sigma_0_512(a) + _SHA_MAJ(a, b, c);
-            } else {
-                static_assert(false, "BAD N");
-            }
-            h = g;
-            g = f;
-            f = e;
-            e = d + t1;
-            d = c;
-            c = b;
-            b = a;
-            a = t1 + t2;
+            _sha2_round<word_t>(s, _sha2_round_constant<word_t>(i) + w[i]);
+        }
+        for (std::size_t i = 0; i < 8; ++i) {
+            hash_val[i] += s[i];
         }
-        hash_val[0] += a;
-        hash_val[1] += b;
-        hash_val[2] += c;
-        hash_val[3] += d;
-        hash_val[4] += e;
-        hash_val[5] += f;
-        hash_val[6] += g;
-        hash_val[7] += h;
     }
 
+    template<auto PREFIX, auto SUFFIX, std::size_t L, std::size_t OFFSET>
+    static constexpr auto _FIXED_MESSAGE = FixedMessage<word_t, T, FixedMessage<word_t, T, 1>::blocks_for(PREFIX.size() + L + SUFFIX.size())>(
+        INIT_HASH_VAL, PREFIX.data(), PREFIX.size(), L, SUFFIX.data(), SUFFIX.size(), OFFSET
+    );
+
+
     void _update(const uint8_t *message) noexcept {
         auto block = message_to_blocks<word_t, 2 * N / sizeof(word_t)>(message);
         sha2_compression(block);
     }
     
-    void _digest(void *out) noexcept {
-        std::array<uint8_t, 2 * N> padded_tmp_message;
-        std::copy(tmp_message.cbegin(), tmp_message.cbegin() + consumed_len % (2*N), padded_tmp_message.begin());
-        sha_pad_end(padded_tmp_message.data() + consumed_len % (2*N), consumed_len);
-        _update(padded_tmp_message.data());
-        blocks_to_bytes<word_t, 8>(out, hash_val);
-    }
 
 public:
 
     static constexpr std::size_t OUTPUT_BITS = M * 8;
     static constexpr std::size_t OUTPUT_SIZE = M;
+    static constexpr std::size_t BLOCK_SIZE = 2 * N;
+    using WORDS = std::array<word_t, 8>;
+
+    /**
+     * @brief serialises the first OUTPUT_SIZE bytes of the digest words
+     */
+    static constexpr void serialize(void *out, const WORDS &words) noexcept {
+        constexpr std::size_t W = sizeof(word_t);
+        for (std::size_t i = 0; i < M; ++i) {
+            static_cast<uint8_t *>(out)[i] = (words[i / W] >> (8 * (W - 1 - i % W))) & 0xFF;
+        }
+    }
+
+    template<std::size_t MAX_BLOCKS>
+    using FIXED_MESSAGE = FixedMessage<word_t, T, MAX_BLOCKS>;
+
+    /**
+     * @brief builds the layout of `prefix_tail || L variable bytes || suffix` for compress_message, at compile time or at run time
+     * @param offset            prefix bytes compressed before the tail (a multiple of BLOCK_SIZE)
+     * @param last_mask         bits of the last variable byte taken from the digest
+     * @param salt              L bytes XORed into the variable bytes (nullptr: none)
+     */
+    template<std::size_t MAX_BLOCKS>
+    static constexpr FIXED_MESSAGE<MAX_BLOCKS> fixed_message(
+        const uint8_t *prefix_tail, const std::size_t prefix_tail_len,
+        const std::size_t L,
+        const uint8_t *suffix, const std::size_t suffix_len,
+        const std::size_t offset,
+        const uint8_t last_mask = 0xFF,
+        const uint8_t *salt = nullptr
+    ) noexcept 
+    {
+        return FIXED_MESSAGE<MAX_BLOCKS>(INIT_HASH_VAL, prefix_tail, prefix_tail_len, L, suffix, suffix_len, offset, last_mask, salt);
+    }
+
+    /**
+     * @brief compresses LANES independent messages of layout `msg`, with the rounds interleaved across lanes
+     * 
+     * The previous digest words are shifted straight into the message words without going through bytes,
+     * XORed onto the salt the layout keeps in the constant part of the variable words. 
+     * When `msg` is a compile-time constant (or a specialization constant of a JIT-compiled kernel) 
+     * the constant schedule words and the precomputed rounds fold away.
+     * @tparam LANES            number of independent messages, advanced in lockstep for instruction-level parallelism
+     * @tparam OUT_WORDS        number of leading digest words to compute in the last block (the others are left zero)
+     * @tparam CALC             type the rounds compute the words in, word_t or, for the SHA-512 family, Word64Pair
+     * @param msg               layout from fixed_message
+     * @param chaining          chaining value after msg.offset bytes, see chaining_value() (ignored if msg.offset is 0)
+     * @param prev              digest words of the previous step of each lane
+     */
+    template<std::size_t LANES, std::size_t OUT_WORDS = 8, typename CALC = word_t, std::size_t MAX_BLOCKS>
+    static constexpr std::array<WORDS, LANES> compress_message(
+        const FIXED_MESSAGE<MAX_BLOCKS> &msg,
+        const WORDS &chaining, 
+        const std::array<WORDS, LANES> &prev
+    ) noexcept 
+    {
+        static_assert(sizeof(CALC) == sizeof(word_t), "CALC must hold one word");
+        constexpr std::ptrdiff_t W = sizeof(word_t);
+        const auto P = static_cast<std::ptrdiff_t>(msg.prefix_len);
+        std::array<std::array<CALC, 8>, LANES> hv;
+        for (std::size_t l = 0; l < LANES; ++l) {
+            for (std::size_t i = 0; i < 8; ++i) {
+                hv[l][i] = msg.offset == 0 ? INIT_HASH_VAL[i] : chaining[i];
+            }
+        }
+        for (std::size_t j = 0; j < MAX_BLOCKS && j < msg.block_count; ++j) {
+            const auto &blk = msg.blocks[j];
+            std::array<std::array<CALC, T>, LANES> w;
+            for (std::size_t l = 0; l < LANES; ++l) {
+                for (std::size_t i = 0; i < T; ++i) {
+                    w[l][i] = blk.w[i];
+                }
+            }
+            for (std::size_t i = 0; i < 16; ++i) {
+                if (blk.mask[i] != 0) {
+                    const auto off = static_cast<std::ptrdiff_t>(j * 2 * N + i * W) - P;
+                    for (std::size_t l = 0; l < LANES; ++l) {
+                        w[l][i] ^= CALC(_sha2_stream_word<word_t>(prev[l], off) & blk.mask[i]);
+                    }
+                }
+            }
+            for (std::size_t i = 16; i < T; ++i) {
+                if (!blk.is_const[i]) {
+                    for (std::size_t l = 0; l < LANES; ++l) {
+                        w[l][i] += _sha2_schedule_word<CALC>(
+                            blk.var_term[i][0] ? w[l][i-2] : CALC{}, blk.var_term[i][1] ? w[l][i-7] : CALC{},
+                            blk.var_term[i][2] ? w[l][i-15] : CALC{}, blk.var_term[i][3] ? w[l][i-16] : CALC{}
+                        );
+                    }
+                }
+            }
+            std::array<std::array<CALC, 8>, LANES> s;
+            for (std::size_t l = 0; l < LANES; ++l) {
+                for (std::size_t i = 0; i < 8; ++i) {
+                    s[l][i] = blk.first_var > 0 ? CALC(blk.state[i]) : hv[l][i];
+                }
+            }
+            for (std::size_t i = blk.first_var; i < T; ++i) {
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    _sha2_round<CALC>(s[l], CALC(_sha2_round_constant<word_t>(i)) + w[l][i]);
+                }
+            }
+            for (std::size_t l = 0; l < LANES; ++l) {
+                for (std::size_t i = 0; i < 8; ++i) {
+                    if (j + 1 < msg.block_count) {
+                        hv[l][i] += s[l][i];
+                    } else {
+                        hv[l][i] = i < OUT_WORDS ? hv[l][i] + s[l][i] : CALC{};
+                    }
+                }
+            }
+        }
+        std::array<WORDS, LANES> out;
+        for (std::size_t l = 0; l < LANES; ++l) {
+            for (std::size_t i = 0; i < 8; ++i) {
+                out[l][i] = static_cast<word_t>(hv[l][i]);
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief compression of the whole message `PREFIX || first L bytes of prev || SUFFIX`
+     * 
+     * The padding, the length word and the prefix/suffix words are folded into the message schedule at compile time,
+     * and the rounds before the first variable schedule word are precomputed.
+     * @tparam OUT_WORDS        number of leading digest words to compute (the others are left zero)
+     * @param prev              digest words of the previous step
+     * @return                  digest words (all 8 by default, including the ones truncated away by OUTPUT_SIZE)
+     */
+    template<auto PREFIX, auto SUFFIX, std::size_t L, std::size_t OUT_WORDS = 8>
+    static constexpr WORDS compress_fixed(const WORDS &prev) noexcept {
+        return compress_message<1, OUT_WORDS>(_FIXED_MESSAGE<PREFIX, SUFFIX, L, 0>, INIT_HASH_VAL, {prev})[0];
+    }
+
+    /**
+     * @brief same as compress_fixed, but resumes from the chaining value after the first OFFSET bytes of the prefix
+     * @tparam PREFIX_TAIL      prefix bytes after the first OFFSET bytes
+     * @tparam OFFSET           prefix bytes already compressed into `midstate` (a multiple of BLOCK_SIZE)
+     * @param midstate          chaining value after OFFSET bytes, see chaining_value() (ignored if OFFSET is 0)
+     * @param prev              digest words of the previous step
+     */
+    template<auto PREFIX_TAIL, auto SUFFIX, std::size_t L, std::size_t OFFSET, std::size_t OUT_WORDS = 8>
+    static constexpr WORDS compress_midstate(const WORDS &midstate, const WORDS &prev) noexcept {
+        return compress_message<1, OUT_WORDS>(_FIXED_MESSAGE<PREFIX_TAIL, SUFFIX, L, OFFSET>, midstate, {prev})[0];
+    }
+
+    /**
+     * @brief chaining value after the full blocks consumed so far
+     */
+    WORDS chaining_value() const noexcept {
+        return hash_val;
+    }
+
+    /**
+     * @brief pads the buffered message and returns the final digest words
+     */
+    WORDS digest_words() noexcept {
+        // the padding spills into a second block when fewer than B / 8 + 1 bytes are left in the last one
+        std::array<uint8_t, 4 * N> padded_tmp_message;
+        const auto remaining = consumed_len % (2*N);
+        std::copy(tmp_message.cbegin(), tmp_message.cbegin() + remaining, padded_tmp_message.begin());
+        sha_pad_end(padded_tmp_message.data() + remaining, consumed_len);
+        _update(padded_tmp_message.data());
+        if (remaining + 2 * N / 8 + 1 > 2 * N) {
+            _update(padded_tmp_message.data() + 2 * N);
+        }
+        return hash_val;
+    }
 
     void update(const void *message, const std::size_t length) noexcept {
         constexpr auto MESSAGE_BLOCK_SIZE = 2 * N;
         const auto msg = reinterpret_cast<const uint8_t *>(message);
-        auto bytes_copied = std::min(length, MESSAGE_BLOCK_SIZE - consumed_len % MESSAGE_BLOCK_SIZE);
-        std::copy(msg, msg + bytes_copied, tmp_message.data() + consumed_len % MESSAGE_BLOCK_SIZE);
-        consumed_len += bytes_copied;
-        while (consumed_len % MESSAGE_BLOCK_SIZE == 0) {
-            _update(tmp_message.data());
-            auto copy_len = std::min(length - bytes_copied, MESSAGE_BLOCK_SIZE);
-            std::copy(msg + bytes_copied, msg + bytes_copied + copy_len, tmp_message.begin());
+        std::size_t bytes_copied = 0;
+        while (bytes_copied < length) {
+            const auto block_offset = consumed_len % MESSAGE_BLOCK_SIZE;
+            const auto copy_len = std::min(length - bytes_copied, MESSAGE_BLOCK_SIZE - block_offset);
+            std::copy(msg + bytes_copied, msg + bytes_copied + copy_len, tmp_message.data() + block_offset);
             bytes_copied += copy_len;
             consumed_len += copy_len;
+            if (consumed_len % MESSAGE_BLOCK_SIZE == 0) {
+                _update(tmp_message.data());
+            }
         }
     }
     void digest(void *out) noexcept {
-        std::array<uint8_t, N> val;
-        _digest(static_cast<uint8_t *>(val.data()));
-        std::copy(val.cbegin(), val.cbegin() + M, static_cast<uint8_t *>(out));
+        serialize(out, digest_words());
     }
     
 };
@@ -315,6 +720,89 @@ class SHA512_256 : public _SHA2_Base<
 > {};
 
 
+/**
+ * @brief truncated digest variant of a SHA-2 function that computes and serialises only the first BYTES bytes of the digest of HASH
+ * @tparam HASH             one of the SHA-2 classes above
+ * @tparam BYTES            number of leading digest bytes kept (must be at most HASH::OUTPUT_SIZE)
+ */
+template<typename HASH, std::size_t BYTES>
+class Truncated : public HASH
+{
+    static_assert(BYTES <= HASH::OUTPUT_SIZE, "cannot truncate to more than the digest size");
+
+public:
 
+    using WORDS = typename HASH::WORDS;
+    static constexpr std::size_t OUTPUT_BITS = BYTES * 8;
+    static constexpr std::size_t OUTPUT_SIZE = BYTES;
+    static constexpr std::size_t OUTPUT_WORDS = CEIL_DIV(BYTES, sizeof(typename WORDS::value_type));
 
+    static constexpr void serialize(void *out, const WORDS &words) noexcept {
+        constexpr std::size_t W = sizeof(typename WORDS::value_type);
+        for (std::size_t i = 0; i < BYTES; ++i) {
+            static_cast<uint8_t *>(out)[i] = (words[i / W] >> (8 * (W - 1 - i % W))) & 0xFF;
+        }
+    }
+
+    template<auto PREFIX, auto SUFFIX, std::size_t L>
+    static constexpr WORDS compress_fixed(const WORDS &prev) noexcept {
+        return HASH::template compress_fixed<PREFIX, SUFFIX, L, OUTPUT_WORDS>(prev);
+    }
+
+    template<auto PREFIX_TAIL, auto SUFFIX, std::size_t L, std::size_t OFFSET>
+    static constexpr WORDS compress_midstate(const WORDS &midstate, const WORDS &prev) noexcept {
+        return HASH::template compress_midstate<PREFIX_TAIL, SUFFIX, L, OFFSET, OUTPUT_WORDS>(midstate, prev);
+    }
+
+    template<std::size_t LANES, std::size_t OUT_WORDS = OUTPUT_WORDS, typename CALC = typename WORDS::value_type, std::size_t MAX_BLOCKS>
+    static constexpr std::array<WORDS, LANES> compress_message(
+        const typename HASH::template FIXED_MESSAGE<MAX_BLOCKS> &msg,
+        const WORDS &chaining, 
+        const std::array<WORDS, LANES> &prev
+    ) noexcept 
+    {
+        return HASH::template compress_message<LANES, (OUT_WORDS < OUTPUT_WORDS ? OUT_WORDS : OUTPUT_WORDS), CALC>(msg, chaining, prev);
+    }
 
+    void digest(void *out) noexcept {
+        serialize(out, this->digest_words());
+    }
+
+};
+
+/**
+ * @brief the untruncated SHA-2 function behind HASH
+ */
+template<typename HASH>
+struct untruncated {
+    using type = HASH;
+};
+
+template<typename HASH, std::size_t BYTES>
+struct untruncated<Truncated<HASH, BYTES>> {
+    using type = HASH;
+};
+
+
+template<typename HASH, auto PREFIX, auto SUFFIX, std::size_t L>
+constexpr typename HASH::WORDS compress_fixed(const typename HASH::WORDS &prev) noexcept {
+    return HASH::template compress_fixed<PREFIX, SUFFIX, L>(prev);
+}
+
+template<typename HASH, auto PREFIX_TAIL, auto SUFFIX, std::size_t L, std::size_t OFFSET>
+constexpr typename HASH::WORDS compress_midstate(const typename HASH::WORDS &midstate, const typename HASH::WORDS &prev) noexcept {
+    return HASH::template compress_midstate<PREFIX_TAIL, SUFFIX, L, OFFSET>(midstate, prev);
+}
+
+/**
+ * @tparam CALC             type the rounds compute the words in (Word64Pair runs the SHA-512 family on 32-bit arithmetic)
+ */
+template<typename HASH, std::size_t LANES, typename CALC = typename HASH::WORDS::value_type, typename MSG>
+constexpr std::array<typename HASH::WORDS, LANES> compress_message(
+    const MSG &msg,
+    const typename HASH::WORDS &chaining, 
+    const std::array<typename HASH::WORDS, LANES> &prev
+) noexcept 
+{
+    return HASH::template compress_message<LANES, 8, CALC>(msg, chaining, prev);
+}
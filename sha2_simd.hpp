@@ -0,0 +1,367 @@
+/**
+ * @file sha2_simd.hpp
+ * @author Steven
+ * @brief Multi-buffer host kernels of the walk step (AVX2, AVX-512 and SHA-NI), selected at run time from CPUID, for CPU nodes without a fast SYCL CPU device
+ * @version 0.1
+ * @date 2026-02-12
+ *
+ * compress_lanes runs the same step as FixedMessage-based compress_message, on up to SIMD_MAX_LANES independent messages:
+ *  - AVX2 / AVX-512: one message per vector lane (8 / 16 lanes of SHA-256 words, 4 / 8 lanes of SHA-512 words),
+ *  - SHA-NI (SHA-224/256 only): the SHA extensions on SHA_NI_LANES messages interleaved for instruction-level parallelism.
+ * The vector kernels are written with GCC/Clang vector extensions and compiled for their instruction set through
+ * target attributes, so they need no -march flag and the binary still runs on CPUs without them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include "sha2.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && !defined(__SYCL_DEVICE_ONLY__)
+#define SHA2_SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define SHA2_SIMD_X86 0
+#endif
+
+enum class SIMD_BACKEND {
+    SCALAR, AVX2, AVX512, SHA_NI
+};
+
+constexpr std::array<std::pair<std::string_view, SIMD_BACKEND>, 4> SIMD_BACKEND_NAMES = {{
+    {"scalar", SIMD_BACKEND::SCALAR}, {"avx2", SIMD_BACKEND::AVX2},
+    {"avx512", SIMD_BACKEND::AVX512}, {"sha-ni", SIMD_BACKEND::SHA_NI}
+}};
+
+constexpr std::size_t SIMD_MAX_LANES = 16;          // Messages per compress_lanes call (the widest backend, AVX-512 on 32-bit words)
+constexpr std::size_t SHA_NI_LANES = 4;             // Messages the SHA-NI kernel interleaves
+
+inline std::string_view simd_backend_name(SIMD_BACKEND backend) noexcept {
+    for (const auto &[name, type] : SIMD_BACKEND_NAMES) {
+        if (type == backend) {
+            return name;
+        }
+    }
+    return "unknown";
+}
+
+/**
+ * @brief whether this CPU (and OS) runs `backend`
+ */
+inline bool simd_supported(SIMD_BACKEND backend) noexcept {
+#if SHA2_SIMD_X86
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    const bool leaf7 = __get_cpuid_count(7, 0, &a, &b, &c, &d);
+    switch (backend) {
+    case SIMD_BACKEND::SCALAR:
+        return true;
+    case SIMD_BACKEND::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SIMD_BACKEND::AVX512:
+        return __builtin_cpu_supports("avx512f");
+    case SIMD_BACKEND::SHA_NI:
+        return leaf7 && (b & (1u << 29)) != 0 && __builtin_cpu_supports("sse4.1");
+    }
+    return false;
+#else
+    return backend == SIMD_BACKEND::SCALAR;
+#endif
+}
+
+/**
+ * @brief the fastest backend this CPU runs for words of `word_size` bytes
+ * 
+ * 16 AVX-512 lanes outrun the SHA extensions on one core, which in turn outrun 8 AVX2 lanes (SHA-NI only covers SHA-224/256).
+ */
+inline SIMD_BACKEND best_simd_backend(std::size_t word_size) noexcept {
+    if (simd_supported(SIMD_BACKEND::AVX512)) {
+        return SIMD_BACKEND::AVX512;
+    }
+    if (word_size == 4 && simd_supported(SIMD_BACKEND::SHA_NI)) {
+        return SIMD_BACKEND::SHA_NI;
+    }
+    if (simd_supported(SIMD_BACKEND::AVX2)) {
+        return SIMD_BACKEND::AVX2;
+    }
+    return SIMD_BACKEND::SCALAR;
+}
+
+/**
+ * @brief messages one call of the `backend` kernel advances together
+ */
+constexpr std::size_t simd_width(SIMD_BACKEND backend, std::size_t word_size) noexcept {
+    switch (backend) {
+    case SIMD_BACKEND::AVX2:
+        return 32 / word_size;
+    case SIMD_BACKEND::AVX512:
+        return 64 / word_size;
+    case SIMD_BACKEND::SHA_NI:
+        return word_size == 4 ? SHA_NI_LANES : 1;
+    default:
+        return 1;
+    }
+}
+
+
+#if SHA2_SIMD_X86
+
+// vector of WIDTH words (spelled out per width, an attribute on a dependent type is ignored)
+template<typename word_t, std::size_t WIDTH>
+struct _simd_word;
+template<> struct _simd_word<uint32_t, 8> { typedef uint32_t type __attribute__((vector_size(32))); };
+template<> struct _simd_word<uint32_t, 16> { typedef uint32_t type __attribute__((vector_size(64))); };
+template<> struct _simd_word<uint64_t, 4> { typedef uint64_t type __attribute__((vector_size(32))); };
+template<> struct _simd_word<uint64_t, 8> { typedef uint64_t type __attribute__((vector_size(64))); };
+
+template<typename word_t, std::size_t WIDTH>
+using SIMD_WORD = typename _simd_word<word_t, WIDTH>::type;
+
+// operands are passed by reference: a vector passed by value out of the kernels' instruction set would change the ABI
+#define _SIMD_ROTR(x, n) (((x) >> (n)) | ((x) << (8 * static_cast<int>(sizeof((x)[0])) - (n))))
+
+template<typename V>
+[[gnu::always_inline]] inline void _simd_add_schedule_word(V &w, const V &w2, const V &w7, const V &w15, const V &w16) noexcept {
+    if constexpr (sizeof(w2[0]) == 4) {
+        w += (_SIMD_ROTR(w2, 17) ^ _SIMD_ROTR(w2, 19) ^ (w2 >> 10)) + w7 + (_SIMD_ROTR(w15, 7) ^ _SIMD_ROTR(w15, 18) ^ (w15 >> 3)) + w16;
+    } else {
+        w += (_SIMD_ROTR(w2, 19) ^ _SIMD_ROTR(w2, 61) ^ (w2 >> 6)) + w7 + (_SIMD_ROTR(w15, 1) ^ _SIMD_ROTR(w15, 8) ^ (w15 >> 7)) + w16;
+    }
+}
+
+template<typename V>
+[[gnu::always_inline]] inline void _simd_round(std::array<V, 8> &s, const V &kw) noexcept {
+    V t1, t2;
+    if constexpr (sizeof(kw[0]) == 4) {
+        t1 = s[7] + (_SIMD_ROTR(s[4], 6) ^ _SIMD_ROTR(s[4], 11) ^ _SIMD_ROTR(s[4], 25)) + _SHA_CH(s[4], s[5], s[6]) + kw;
+        t2 = (_SIMD_ROTR(s[0], 2) ^ _SIMD_ROTR(s[0], 13) ^ _SIMD_ROTR(s[0], 22)) + _SHA_MAJ(s[0], s[1], s[2]);
+    } else {
+        t1 = s[7] + (_SIMD_ROTR(s[4], 14) ^ _SIMD_ROTR(s[4], 18) ^ _SIMD_ROTR(s[4], 41)) + _SHA_CH(s[4], s[5], s[6]) + kw;
+        t2 = (_SIMD_ROTR(s[0], 28) ^ _SIMD_ROTR(s[0], 34) ^ _SIMD_ROTR(s[0], 39)) + _SHA_MAJ(s[0], s[1], s[2]);
+    }
+    s[7] = s[6];
+    s[6] = s[5];
+    s[5] = s[4];
+    s[4] = s[3] + t1;
+    s[3] = s[2];
+    s[2] = s[1];
+    s[1] = s[0];
+    s[0] = t1 + t2;
+}
+
+/**
+ * @brief compress_message of WIDTH messages, message l in lane l of every vector word
+ */
+template<std::size_t WIDTH, typename word_t, std::size_t T, std::size_t MAX_BLOCKS>
+[[gnu::always_inline]] inline void _simd_compress(
+    const FixedMessage<word_t, T, MAX_BLOCKS> &msg,
+    const std::array<word_t, 8> &init,
+    const std::array<word_t, 8> &chaining,
+    const std::array<word_t, 8> *prev,
+    std::array<word_t, 8> *next
+) noexcept {
+    using V = SIMD_WORD<word_t, WIDTH>;
+    constexpr std::ptrdiff_t W = sizeof(word_t);
+    const auto P = static_cast<std::ptrdiff_t>(msg.prefix_len);
+    std::array<V, 8> hv;
+    for (std::size_t i = 0; i < 8; ++i) {
+        hv[i] = V{} + (msg.offset == 0 ? init[i] : chaining[i]);
+    }
+    for (std::size_t j = 0; j < MAX_BLOCKS && j < msg.block_count; ++j) {
+        const auto &blk = msg.blocks[j];
+        std::array<V, T> w;
+        for (std::size_t i = 0; i < T; ++i) {
+            w[i] = V{} + blk.w[i];
+        }
+        for (std::size_t i = 0; i < 16; ++i) {
+            if (blk.mask[i] != 0) {
+                const auto off = static_cast<std::ptrdiff_t>(j * 16 * W + i * W) - P;
+                V stream;
+                for (std::size_t l = 0; l < WIDTH; ++l) {
+                    stream[l] = _sha2_stream_word<word_t>(prev[l], off);
+                }
+                w[i] ^= stream & blk.mask[i];
+            }
+        }
+        for (std::size_t i = 16; i < T; ++i) {
+            if (!blk.is_const[i]) {
+                const V zero{};
+                _simd_add_schedule_word<V>(w[i],
+                    blk.var_term[i][0] ? w[i-2] : zero, blk.var_term[i][1] ? w[i-7] : zero,
+                    blk.var_term[i][2] ? w[i-15] : zero, blk.var_term[i][3] ? w[i-16] : zero
+                );
+            }
+        }
+        std::array<V, 8> s;
+        for (std::size_t i = 0; i < 8; ++i) {
+            s[i] = blk.first_var > 0 ? V{} + blk.state[i] : hv[i];
+        }
+        for (std::size_t i = blk.first_var; i < T; ++i) {
+            const V kw = w[i] + _sha2_round_constant<word_t>(i);
+            _simd_round<V>(s, kw);
+        }
+        for (std::size_t i = 0; i < 8; ++i) {
+            hv[i] += s[i];
+        }
+    }
+    for (std::size_t l = 0; l < WIDTH; ++l) {
+        for (std::size_t i = 0; i < 8; ++i) {
+            next[l][i] = hv[i][l];
+        }
+    }
+}
+
+template<typename word_t, std::size_t T, std::size_t MAX_BLOCKS>
+__attribute__((target("avx2"))) void _avx2_compress(
+    const FixedMessage<word_t, T, MAX_BLOCKS> &msg, const std::array<word_t, 8> &init, const std::array<word_t, 8> &chaining,
+    const std::array<word_t, 8> *prev, std::array<word_t, 8> *next
+) noexcept {
+    _simd_compress<32 / sizeof(word_t)>(msg, init, chaining, prev, next);
+}
+
+template<typename word_t, std::size_t T, std::size_t MAX_BLOCKS>
+__attribute__((target("avx512f"))) void _avx512_compress(
+    const FixedMessage<word_t, T, MAX_BLOCKS> &msg, const std::array<word_t, 8> &init, const std::array<word_t, 8> &chaining,
+    const std::array<word_t, 8> *prev, std::array<word_t, 8> *next
+) noexcept {
+    _simd_compress<64 / sizeof(word_t)>(msg, init, chaining, prev, next);
+}
+
+/**
+ * @brief SHA_NI_LANES SHA-256 compressions of one block each, every state as {ABEF, CDGH} and every block as 16 words
+ */
+__attribute__((target("sha,sse4.1"))) inline void _sha_ni_blocks(
+    __m128i (&state)[2 * SHA_NI_LANES],
+    const std::array<std::array<uint32_t, 16>, SHA_NI_LANES> &block
+) noexcept {
+    __m128i m[4 * SHA_NI_LANES], saved[2 * SHA_NI_LANES];
+    std::copy(state, state + 2 * SHA_NI_LANES, saved);
+    for (std::size_t l = 0; l < SHA_NI_LANES; ++l) {
+        for (std::size_t g = 0; g < 4; ++g) {
+            m[4 * l + g] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block[l].data() + 4 * g));
+        }
+    }
+    for (std::size_t g = 0; g < 16; ++g) {
+        const __m128i k = _mm_set_epi32(
+            static_cast<int>(_ROUND_CONSTANTS_256[4 * g + 3]), static_cast<int>(_ROUND_CONSTANTS_256[4 * g + 2]),
+            static_cast<int>(_ROUND_CONSTANTS_256[4 * g + 1]), static_cast<int>(_ROUND_CONSTANTS_256[4 * g])
+        );
+        for (std::size_t l = 0; l < SHA_NI_LANES; ++l) {
+            __m128i *mg = m + 4 * l;
+            __m128i kw = _mm_add_epi32(mg[g % 4], k);
+            state[2 * l + 1] = _mm_sha256rnds2_epu32(state[2 * l + 1], state[2 * l], kw);
+            kw = _mm_shuffle_epi32(kw, 0x0E);
+            state[2 * l] = _mm_sha256rnds2_epu32(state[2 * l], state[2 * l + 1], kw);
+            if (g < 12) {
+                // words 4(g+4)..4(g+4)+3 of the schedule replace words 4g..4g+3
+                const __m128i t = _mm_add_epi32(_mm_sha256msg1_epu32(mg[g % 4], mg[(g + 1) % 4]), _mm_alignr_epi8(mg[(g + 3) % 4], mg[(g + 2) % 4], 4));
+                mg[g % 4] = _mm_sha256msg2_epu32(t, mg[(g + 3) % 4]);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < 2 * SHA_NI_LANES; ++i) {
+        state[i] = _mm_add_epi32(state[i], saved[i]);
+    }
+}
+
+__attribute__((target("sha,sse4.1"))) inline void _sha_ni_load(__m128i &abef, __m128i &cdgh, const std::array<uint32_t, 8> &h) noexcept {
+    const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(h.data())), 0xB1);
+    const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(h.data() + 4)), 0x1B);
+    abef = _mm_alignr_epi8(dcba, efgh, 8);
+    cdgh = _mm_blend_epi16(efgh, dcba, 0xF0);
+}
+
+__attribute__((target("sha,sse4.1"))) inline void _sha_ni_store(std::array<uint32_t, 8> &h, const __m128i abef, const __m128i cdgh) noexcept {
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(h.data()), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(h.data() + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/**
+ * @brief the walk step with the SHA extensions: the message words of every block are assembled from the layout
+ * and the whole block is compressed (the extensions compute their own schedule, so the folded rounds are not used)
+ */
+template<std::size_t T, std::size_t MAX_BLOCKS>
+__attribute__((target("sha,sse4.1"))) void _sha_ni_compress(
+    const FixedMessage<uint32_t, T, MAX_BLOCKS> &msg, const std::array<uint32_t, 8> &init, const std::array<uint32_t, 8> &chaining,
+    const std::array<uint32_t, 8> *prev, std::array<uint32_t, 8> *next
+) noexcept {
+    const auto P = static_cast<std::ptrdiff_t>(msg.prefix_len);
+    __m128i state[2 * SHA_NI_LANES];
+    for (std::size_t l = 0; l < SHA_NI_LANES; ++l) {
+        _sha_ni_load(state[2 * l], state[2 * l + 1], msg.offset == 0 ? init : chaining);
+    }
+    for (std::size_t j = 0; j < MAX_BLOCKS && j < msg.block_count; ++j) {
+        const auto &blk = msg.blocks[j];
+        std::array<std::array<uint32_t, 16>, SHA_NI_LANES> block;
+        for (std::size_t l = 0; l < SHA_NI_LANES; ++l) {
+            for (std::size_t i = 0; i < 16; ++i) {
+                const auto off = static_cast<std::ptrdiff_t>(j * 64 + i * 4) - P;
+                block[l][i] = blk.mask[i] != 0 ? blk.w[i] ^ (_sha2_stream_word<uint32_t>(prev[l], off) & blk.mask[i]) : blk.w[i];
+            }
+        }
+        _sha_ni_blocks(state, block);
+    }
+    for (std::size_t l = 0; l < SHA_NI_LANES; ++l) {
+        _sha_ni_store(next[l], state[2 * l], state[2 * l + 1]);
+    }
+}
+
+#endif
+
+
+/**
+ * @brief advances `count` independent messages of layout `msg` by one compression on the host with `backend`
+ *
+ * Same result as HASH::compress_message (all 8 digest words are computed), in calls of simd_width(backend) messages,
+ * the last one padded with copies of the last message.
+ * @pre count <= SIMD_MAX_LANES and simd_supported(backend)
+ * @param msg               layout from HASH::fixed_message
+ * @param chaining          chaining value after msg.offset bytes (ignored if msg.offset is 0)
+ */
+template<typename HASH, typename MSG>
+void compress_lanes(
+    SIMD_BACKEND backend,
+    const MSG &msg,
+    const typename HASH::WORDS &chaining,
+    const typename HASH::WORDS *prev,
+    typename HASH::WORDS *next,
+    std::size_t count
+) noexcept {
+    using word_t = typename HASH::WORDS::value_type;
+    const std::size_t width = simd_width(backend, sizeof(word_t));
+    [[maybe_unused]] const auto init = HASH{}.chaining_value();
+    std::array<typename HASH::WORDS, SIMD_MAX_LANES> in, out;
+    for (std::size_t first = 0; first < count; first += width) {
+        const std::size_t lanes = std::min(width, count - first);
+        for (std::size_t l = 0; l < width; ++l) {
+            in[l] = prev[first + std::min(l, lanes - 1)];
+        }
+        switch (backend) {
+#if SHA2_SIMD_X86
+        case SIMD_BACKEND::AVX2:
+            _avx2_compress(msg, init, chaining, in.data(), out.data());
+            break;
+        case SIMD_BACKEND::AVX512:
+            _avx512_compress(msg, init, chaining, in.data(), out.data());
+            break;
+        case SIMD_BACKEND::SHA_NI:
+            if constexpr (sizeof(word_t) == 4) {
+                _sha_ni_compress(msg, init, chaining, in.data(), out.data());
+            } else {
+                out[0] = HASH::template compress_message<1>(msg, chaining, {in[0]})[0];
+            }
+            break;
+#endif
+        default:
+            out[0] = HASH::template compress_message<1>(msg, chaining, {in[0]})[0];
+            break;
+        }
+        std::copy(out.begin(), out.begin() + lanes, next + first);
+    }
+}
@@ -0,0 +1,201 @@
+/**
+ * @file stage_two.hpp
+ * @author Steven
+ * @brief Stage 2 of the VOW search: the two chains of a DP collision walked to their merge on the host, and the collision report
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <vector>
+#include "sha2.hpp"
+#include "sha2_simd.hpp"
+#include "config.hpp"
+#include "telemetry.hpp"
+#include "walk.hpp"
+
+template<typename HASH, std::size_t N>
+struct StageTwoState {
+    const Config *config;
+    std::vector<uint8_t> in;
+    HASH_OUT<HASH> out;
+    std::size_t hash_count = 0;
+
+    StageTwoState(const Config &config, const MIDDLE<N> &start): config{&config}, in{format_input<N>(config, start)} {
+        HASH hash_func;
+        hash_func.update(in.data(), in.size());
+        hash_func.digest(out.data());
+        ++hash_count;
+    }
+    bool operator==(const StageTwoState &other) const noexcept {
+        const uint8_t last_mask = last_byte_mask(N, config->collision_bits());
+        return std::memcmp(out.data(), other.out.data(), N - 1) == 0 && ((out[N - 1] ^ other.out[N - 1]) & last_mask) == 0;
+    }
+    void step() noexcept {
+        HASH hash_func;
+        in = format_input<N>(*config, out);
+        hash_func.update(in.data(), in.size());
+        hash_func.digest(out.data());
+        ++hash_count;
+    }
+};
+
+/**
+ * @brief the host kernel that steps `chains` (1 or 2) chains fastest
+ *
+ * Every step of a chain needs the previous one, so a vector kernel only has `chains` lanes of work:
+ * the SHA extensions win where they run, otherwise the scalar step for one chain and the vector kernels for two.
+ */
+inline SIMD_BACKEND chain_backend(std::size_t word_size, std::size_t chains) noexcept {
+    if (word_size == 4 && simd_supported(SIMD_BACKEND::SHA_NI)) {
+        return SIMD_BACKEND::SHA_NI;
+    }
+    return chains > 1 ? best_simd_backend(word_size) : SIMD_BACKEND::SCALAR;
+}
+
+/**
+ * @brief stage 2 on the host: walks the two chains of a DP collision to the step where they merge
+ * 
+ * The chains are re-walked with the midstate step of stage 1 through compress_lanes (chain_backend), both in one call once they are aligned,
+ * and only the two inputs found are hashed in full into the returned states.
+ * @param walk              the walk of stage 1 (on the host, not a device_walk)
+ */
+template<typename HASH, std::size_t N>
+std::tuple<StageTwoState<HASH, N>, StageTwoState<HASH, N>> vow_stage_two(
+    const Config &config, 
+    const Walk<HASH> &walk, 
+    const StageOneResult<HASH, N> &stage_one, 
+    std::ostream &os=std::cout
+) {
+    constexpr std::size_t word_size = sizeof(typename HASH_WORDS<HASH>::value_type);
+    const auto one_chain = chain_backend(word_size, 1);
+    const auto two_chains = chain_backend(word_size, 2);
+    std::array<HASH_WORDS<HASH>, 2> chains = {hash_to_words<HASH>(stage_one.x), hash_to_words<HASH>(stage_one.y)}, next;
+    std::array<std::size_t, 2> walked = {0, 0};
+    auto x_steps = stage_one.x_steps;
+    auto y_steps = stage_one.y_steps;
+    auto at = [&](std::size_t chain) {
+        return point<N>(words_to_middle<HASH, N>(chains[chain]), walk.last_mask);
+    };
+    auto print_points = [&] {
+        print_arr(os, at(0));
+        os << "\t";
+        print_arr(os, at(1));
+        os << std::endl;
+    };
+    
+    os << std::dec << "Before: " << "x_steps: " << x_steps << ", y_steps: " << y_steps << "\n";
+    print_points();
+
+    const std::size_t longer = x_steps > y_steps ? 0 : 1;
+    const auto shorter_steps = std::min(x_steps, y_steps);
+    for (auto &longer_steps = longer == 0 ? x_steps : y_steps; longer_steps > shorter_steps; --longer_steps, ++walked[longer]) {
+        compress_lanes<HASH>(one_chain, walk.message, walk.midstate, &chains[longer], &next[longer], 1);
+        chains[longer] = next[longer];
+    }
+    os << std::dec << "Equal: " << "x_steps: " << x_steps << ", y_steps: " << y_steps << "\n";
+    print_points();
+
+    for (; x_steps > 0 && y_steps > 0; --x_steps, --y_steps) {
+        compress_lanes<HASH>(two_chains, walk.message, walk.midstate, chains.data(), next.data(), 2);
+        ++walked[0];
+        ++walked[1];
+        if (point<N>(words_to_middle<HASH, N>(next[0]), walk.last_mask) == point<N>(words_to_middle<HASH, N>(next[1]), walk.last_mask)) {
+            break;
+        }
+        chains = next;
+    }
+    auto x_state = StageTwoState<HASH, N>(config, at(0));
+    auto y_state = StageTwoState<HASH, N>(config, at(1));
+    x_state.hash_count += walked[0];
+    y_state.hash_count += walked[1];
+    os << std::dec << "Result:\n"
+        << "x_steps: " << x_steps << ", y_steps: " << y_steps << "\n"
+        << "x_state == y_state: " << (x_state == y_state ? "true" : "false") << std::endl;
+    print_arr(os, x_state.out);
+    os << "\t";
+    print_arr(os, y_state.out);
+    os << std::endl;
+    return std::make_tuple(x_state, y_state);
+}
+
+
+/**
+ * @brief the full digest of `in` (the walk may only have computed a truncated one)
+ */
+template<typename HASH>
+HASH_OUT<typename untruncated<HASH>::type> full_digest(const std::vector<uint8_t> &in) {
+    using FULL_HASH = typename untruncated<HASH>::type;
+    HASH_OUT<FULL_HASH> out;
+    FULL_HASH hash_func;
+    hash_func.update(in.data(), in.size());
+    hash_func.digest(out.data());
+    return out;
+}
+
+/**
+ * @brief number of leading bits two digests have in common
+ */
+template<typename OUT>
+std::size_t matched_bits(const OUT &x, const OUT &y) noexcept {
+    std::size_t n = 0;
+    for (; n < 8 * x.size() && ((x[n / 8] ^ y[n / 8]) & (0x80 >> n % 8)) == 0; ++n);
+    return n;
+}
+
+template<typename HASH, std::size_t N>
+std::size_t print_collision(
+    const StageTwoState<HASH, N> &x_state, 
+    const StageTwoState<HASH, N> &y_state, 
+    std::size_t total_hash_counts, 
+    double duration, 
+    std::ostream &os=std::cout
+) {
+    // the walk may only have computed a truncated digest, report the full one
+    const auto x_out = full_digest<HASH>(x_state.in);
+    const auto y_out = full_digest<HASH>(y_state.in);
+    const std::size_t n = matched_bits(x_out, y_out);
+    
+    if (x_state == y_state && x_state.in != y_state.in) {
+        os << std::dec << "Found a partial collision! (" << n << " bits matched)\n"
+            << "Total hash counts: " << total_hash_counts << "\n"
+            << "Duration: " << duration << " seconds\n"
+            << "Hashing speed: " << hash_rate(total_hash_counts, duration) << " hashes per second\n";
+        os << "Input 1: ";
+        print_arr(os, x_state.in);
+        os << "\nOutput 1: ";
+        print_arr(os, x_out);
+        os << "\nInput 2: ";
+        print_arr(os, y_state.in);
+        os << "\nOutput 2: ";
+        print_arr(os, y_out);
+        os << std::endl;
+        return n;
+    } else {
+        os << "no collision." << std::endl;
+        return n;
+    }
+}
+
+
+/**
+ * @brief stage 2 of a DP collision, walked to the collision on the host
+ * @param hash_counts       incremented by the hashes of stage 2
+ */
+template<typename HASH, std::size_t N>
+std::tuple<StageTwoState<HASH, N>, StageTwoState<HASH, N>> run_stage_two(
+    const Config &config, 
+    const Walk<HASH> &walk, 
+    const StageOneResult<HASH, N> &stage_one, 
+    std::size_t &hash_counts, 
+    std::ostream &os
+) {
+    auto states = vow_stage_two<HASH, N>(config, walk, stage_one, os);
+    hash_counts += std::get<0>(states).hash_count + std::get<1>(states).hash_count;
+    return states;
+}
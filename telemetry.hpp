@@ -0,0 +1,101 @@
+/**
+ * @file telemetry.hpp
+ * @author Steven
+ * @brief JSON lines output shared by the per-batch telemetry of a campaign and the benchmark, and the timing and expected-work figures they report
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief one JSON object on one line, written field by field and closed (and flushed) by the destructor
+ */
+class JsonLine
+{
+
+public:
+
+    explicit JsonLine(std::ostream &os): os{os} {
+        os << "{";
+    }
+
+    ~JsonLine() {
+        os << "}" << std::endl;
+    }
+
+    JsonLine(const JsonLine &) = delete;
+    JsonLine &operator=(const JsonLine &) = delete;
+
+    template <typename T>
+    JsonLine &add(std::string_view key, const T &value) {
+        os << (first ? "" : ",");
+        first = false;
+        put_string(key);
+        os << ":";
+        if constexpr (std::is_same_v<T, bool>) {
+            os << (value ? "true" : "false");
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (std::isfinite(value)) {
+                os << std::dec << value;
+            } else {
+                os << "null";
+            }
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            os << std::dec << value;
+        } else {
+            put_string(value);
+        }
+        return *this;
+    }
+
+private:
+
+    std::ostream &os;
+    bool first = true;
+
+    void put_string(std::string_view text) {
+        os << '"';
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                os << '\\';
+            }
+            os << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+        }
+        os << '"';
+    }
+
+};
+
+/**
+ * @brief wall time between two points in seconds, to the steady clock's resolution (a short stage must not read as 0 seconds)
+ */
+inline double elapsed_seconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) noexcept {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * @brief hashes per second, 0 if no time was measured
+ */
+inline std::size_t hash_rate(std::size_t hash_counts, double seconds) noexcept {
+    return seconds > 0 ? static_cast<std::size_t>(static_cast<double>(hash_counts) / seconds) : 0;
+}
+
+/**
+ * @brief expected hashes until `collisions` collisions on the first `bits` bits of a random function, found by `walkers` walks with a DP every 2^dp_bits steps
+ *
+ * sqrt(pi/2 * 2^bits) for the first one; after H hashes about H^2 / 2^(bits+1) pairs collided, so the m-th takes sqrt(2m * 2^bits).
+ * The walks still open when the trails merged add about one DP distance 2^dp_bits per walker on top.
+ */
+inline double expected_vow_work(std::size_t bits, std::size_t collisions = 1, std::size_t walkers = 0, std::size_t dp_bits = 0) noexcept {
+    const double space = std::ldexp(1.0, static_cast<int>(bits));
+    return std::sqrt((collisions <= 1 ? std::acos(-1.0) / 2 : 2.0 * static_cast<double>(collisions)) * space)
+        + std::ldexp(static_cast<double>(walkers), static_cast<int>(dp_bits));
+}
@@ -0,0 +1,451 @@
+/**
+ * @file test.cpp
+ * @author Steven
+ * @brief Checks of the fast paths against their references: the FixedMessage walk step against the streaming SHA-2 functions,
+ * the multi-buffer host kernels against the scalar step, the 32-bit pair arithmetic of the SHA-512 family against native 64-bit words,
+ * and the DP table, its Bloom filter, its mapped store and the DP batch codec
+ * @version 0.1
+ * @date 2026-02-12
+ *
+ * Every check draws its cases from a fixed-seed generator, so a failure is reproduced by running the binary again.
+ * A failed check is printed with its case, and the exit status is the number of failed checks (0: all passed).
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "sha2.hpp"
+#include "sha2_simd.hpp"
+#include "dp_table.hpp"
+#include "vow.hpp"
+
+constexpr std::size_t TEST_CASES = 200;             // Random cases of every check
+constexpr std::size_t TEST_MAX_BLOCKS = 4;          // Capacity in blocks of the message layouts under test
+constexpr uint64_t TEST_SEED = 0x5ee0;              // Seed of the case generator
+constexpr std::size_t TEST_KEY_LEN = 10;            // Key bytes of the DP tables under test (of TEST_MAX_KEY_LEN)
+constexpr std::size_t TEST_MAX_KEY_LEN = 12;
+constexpr std::size_t TEST_TABLE_BYTES = 1 << 16;   // Memory budget of the DP tables under test
+constexpr std::size_t TEST_SHARDS = 4;
+constexpr std::size_t TEST_FILTER_KEYS = 1 << 14;   // Keys added to the Bloom filter under test, at 10 bits per key
+constexpr double TEST_MAX_FALSE_POSITIVES = 0.03;   // Bound on its false positive rate (about 1% expected)
+
+/**
+ * @brief counts the checks and reports the failed ones on std::cerr
+ */
+class Checks
+{
+
+public:
+
+    void operator()(bool ok, std::string_view check, const std::string &what) {
+        ++total;
+        if (!ok) {
+            ++failures;
+            std::cerr << "FAILED " << check << ": " << what << std::endl;
+        }
+    }
+
+    std::size_t failed() const noexcept {
+        return failures;
+    }
+
+    std::size_t count() const noexcept {
+        return total;
+    }
+
+private:
+
+    std::size_t total = 0;
+    std::size_t failures = 0;
+
+};
+
+/**
+ * @brief one step of the walk: `prefix || L variable bytes || suffix`, where the variable bytes are the leading digest bytes of `prev`
+ */
+template <typename HASH>
+struct StepCase {
+    std::vector<uint8_t> prefix;
+    std::vector<uint8_t> suffix;
+    std::vector<uint8_t> salt;              // L bytes, or empty
+    std::size_t L = 0;
+    uint8_t last_mask = 0xFF;
+    typename HASH::WORDS prev{};
+
+    std::string describe() const {
+        return "prefix " + std::to_string(prefix.size()) + " B, L " + std::to_string(L) + ", suffix " + std::to_string(suffix.size())
+            + " B, last mask " + std::to_string(last_mask) + (salt.empty() ? "" : ", salted");
+    }
+
+    /**
+     * @brief the variable bytes the step hashes: the digest bytes of `prev`, salted, with the bits past the last mask cleared
+     */
+    std::vector<uint8_t> middle() const {
+        using word_t = typename HASH::WORDS::value_type;
+        std::vector<uint8_t> bytes(L);
+        for (std::size_t i = 0; i < L; ++i) {
+            bytes[i] = static_cast<uint8_t>(prev[i / sizeof(word_t)] >> (8 * (sizeof(word_t) - 1 - i % sizeof(word_t))));
+            bytes[i] ^= salt.empty() ? 0 : salt[i];
+        }
+        bytes[L - 1] &= last_mask;
+        return bytes;
+    }
+
+    /**
+     * @brief the reference: the whole input through HASH::update and digest_words
+     */
+    typename HASH::WORDS reference() const {
+        const auto variable = middle();
+        HASH hash_func;
+        hash_func.update(prefix.data(), prefix.size());
+        hash_func.update(variable.data(), variable.size());
+        hash_func.update(suffix.data(), suffix.size());
+        return hash_func.digest_words();
+    }
+
+    /**
+     * @brief the layout after the first `offset` prefix bytes, with the chaining value it resumes from
+     */
+    std::pair<typename HASH::template FIXED_MESSAGE<TEST_MAX_BLOCKS>, typename HASH::WORDS> layout(std::size_t offset) const {
+        HASH hash_func;
+        hash_func.update(prefix.data(), offset);
+        return {
+            HASH::template fixed_message<TEST_MAX_BLOCKS>(prefix.data() + offset, prefix.size() - offset, L, suffix.data(), suffix.size(),
+                offset, last_mask, salt.empty() ? nullptr : salt.data()),
+            hash_func.chaining_value()
+        };
+    }
+};
+
+/**
+ * @brief a random step that fits TEST_MAX_BLOCKS after its midstate: prefixes of up to two blocks and a ragged tail,
+ * L of 1 to 16 bytes with a bit-granular last byte, suffixes up to a block and a salt in half of the cases
+ */
+template <typename HASH>
+StepCase<HASH> random_step(std::mt19937_64 &rng) {
+    auto draw = [&](std::size_t bound) {
+        return static_cast<std::size_t>(rng() % (bound + 1));
+    };
+    auto bytes = [&](std::size_t len) {
+        std::vector<uint8_t> out(len);
+        for (auto &b : out) {
+            b = static_cast<uint8_t>(rng());
+        }
+        return out;
+    };
+    StepCase<HASH> step;
+    do {
+        step.prefix = bytes(draw(2 * HASH::BLOCK_SIZE + HASH::BLOCK_SIZE / 2));
+        step.L = 1 + draw(15);
+        step.suffix = bytes(draw(HASH::BLOCK_SIZE));
+    } while (!HASH::template FIXED_MESSAGE<TEST_MAX_BLOCKS>::fits(step.prefix.size() % HASH::BLOCK_SIZE, step.L, step.suffix.size()));
+    step.last_mask = static_cast<uint8_t>(0xFF << draw(7));
+    if (rng() % 2) {
+        step.salt = bytes(step.L);
+    }
+    for (auto &w : step.prev) {
+        w = static_cast<typename HASH::WORDS::value_type>(rng());
+    }
+    return step;
+}
+
+
+/**
+ * @brief compress_message with and without the midstate against the streaming hash, on random steps
+ */
+template <typename HASH>
+void check_compress_message(Checks &check, std::string_view name, std::mt19937_64 &rng) {
+    for (std::size_t c = 0; c < TEST_CASES; ++c) {
+        const auto step = random_step<HASH>(rng);
+        const auto expected = step.reference();
+        const std::size_t midstate = step.prefix.size() / HASH::BLOCK_SIZE * HASH::BLOCK_SIZE;
+        for (const auto offset : {std::size_t{0}, midstate}) {
+            if (!HASH::template FIXED_MESSAGE<TEST_MAX_BLOCKS>::fits(step.prefix.size() - offset, step.L, step.suffix.size())) {
+                continue;
+            }
+            const auto [msg, chaining] = step.layout(offset);
+            const auto words = compress_message<HASH, 1>(msg, chaining, {step.prev})[0];
+            check(words == expected, std::string(name) + " compress_message", step.describe() + ", offset " + std::to_string(offset));
+        }
+    }
+}
+
+/**
+ * @brief the compile-time layouts of compress_fixed and compress_midstate against the streaming hash
+ */
+template <typename HASH>
+void check_compress_fixed(Checks &check, std::string_view name) {
+    static constexpr auto PREFIX = [] {
+        std::array<uint8_t, HASH::BLOCK_SIZE + 5> prefix{};
+        for (std::size_t i = 0; i < prefix.size(); ++i) {
+            prefix[i] = static_cast<uint8_t>(7 * i + 1);
+        }
+        return prefix;
+    }();
+    static constexpr auto PREFIX_TAIL = [] {
+        std::array<uint8_t, PREFIX.size() - HASH::BLOCK_SIZE> tail{};
+        std::copy(PREFIX.begin() + HASH::BLOCK_SIZE, PREFIX.end(), tail.begin());
+        return tail;
+    }();
+    static constexpr std::array<uint8_t, 3> SUFFIX = {0x33, 0x22, 0x11};
+    constexpr std::size_t L = 8;
+    StepCase<HASH> step;
+    step.prefix.assign(PREFIX.begin(), PREFIX.end());
+    step.suffix.assign(SUFFIX.begin(), SUFFIX.end());
+    step.L = L;
+    for (std::size_t i = 0; i < step.prev.size(); ++i) {
+        step.prev[i] = static_cast<typename HASH::WORDS::value_type>(0x0123456789abcdefull * (i + 1));
+    }
+    const auto expected = step.reference();
+    check(HASH::template compress_fixed<PREFIX, SUFFIX, L>(step.prev) == expected, std::string(name) + " compress_fixed", step.describe());
+    HASH hash_func;
+    hash_func.update(PREFIX.data(), HASH::BLOCK_SIZE);
+    check(HASH::template compress_midstate<PREFIX_TAIL, SUFFIX, L, HASH::BLOCK_SIZE>(hash_func.chaining_value(), step.prev) == expected,
+        std::string(name) + " compress_midstate", step.describe());
+}
+
+/**
+ * @brief compress_lanes of every backend this CPU runs against the scalar compress_message, lane by lane,
+ * for every message count up to SIMD_MAX_LANES (so the last call of a backend is padded unless the count fills it)
+ */
+template <typename HASH>
+void check_compress_lanes(Checks &check, std::string_view name, std::mt19937_64 &rng) {
+    using WORDS = typename HASH::WORDS;
+    for (const auto &[kernel, backend] : SIMD_BACKEND_NAMES) {
+        if (!simd_supported(backend) || (backend == SIMD_BACKEND::SHA_NI && sizeof(typename WORDS::value_type) != 4)) {
+            continue;
+        }
+        for (std::size_t c = 0; c < TEST_CASES / 10; ++c) {
+            const auto step = random_step<HASH>(rng);
+            const auto [msg, chaining] = step.layout(step.prefix.size() / HASH::BLOCK_SIZE * HASH::BLOCK_SIZE);
+            std::array<WORDS, SIMD_MAX_LANES> prev, next;
+            for (auto &words : prev) {
+                for (auto &w : words) {
+                    w = static_cast<typename WORDS::value_type>(rng());
+                }
+            }
+            for (std::size_t count = 1; count <= SIMD_MAX_LANES; ++count) {
+                const WORDS untouched = {1, 2, 3, 4, 5, 6, 7, 8};
+                next.fill(untouched);
+                compress_lanes<HASH>(backend, msg, chaining, prev.data(), next.data(), count);
+                bool ok = true;
+                for (std::size_t l = 0; l < SIMD_MAX_LANES; ++l) {
+                    ok = ok && next[l] == (l < count ? compress_message<HASH, 1>(msg, chaining, {prev[l]})[0] : untouched);
+                }
+                check(ok, std::string(name) + " compress_lanes " + std::string(kernel), step.describe() + ", " + std::to_string(count) + " messages");
+            }
+        }
+    }
+}
+
+/**
+ * @brief the SHA-512 family computed in Word64Pair (the kernels of devices with weak 64-bit integers) against native uint64_t words
+ */
+template <typename HASH>
+void check_word64_pairs(Checks &check, std::string_view name, std::mt19937_64 &rng) {
+    constexpr std::size_t LANES = 2;
+    for (std::size_t c = 0; c < TEST_CASES; ++c) {
+        const auto step = random_step<HASH>(rng);
+        const auto [msg, chaining] = step.layout(step.prefix.size() / HASH::BLOCK_SIZE * HASH::BLOCK_SIZE);
+        std::array<typename HASH::WORDS, LANES> prev = {step.prev, step.prev};
+        prev[1][0] = ~prev[1][0];
+        const auto paired = compress_message<HASH, LANES, Word64Pair>(msg, chaining, prev);
+        check(paired == compress_message<HASH, LANES>(msg, chaining, prev), std::string(name) + " Word64Pair", step.describe());
+        check(paired[0] == step.reference(), std::string(name) + " Word64Pair against the streaming hash", step.describe());
+    }
+}
+
+using TestTable = DPTable<TEST_MAX_KEY_LEN, uint64_t>;
+using TestStore = ShardedDPTable<TEST_MAX_KEY_LEN, uint64_t>;
+
+/**
+ * @brief the i-th of a sequence of distinct keys: a bijection of i in the first 8 bytes, random bytes up to TEST_KEY_LEN, zero past it
+ */
+TestTable::KEY test_key(uint64_t i, std::mt19937_64 &rng) {
+    TestTable::KEY key = {0};
+    const uint64_t mixed = (i + 1) * 0xD6E8FEB86659FD93ull;
+    std::memcpy(key.data(), &mixed, sizeof(mixed));
+    for (std::size_t b = sizeof(mixed); b < TEST_KEY_LEN; ++b) {
+        key[b] = static_cast<uint8_t>(rng());
+    }
+    return key;
+}
+
+/**
+ * @brief DPTable fills up to its capacity and then reports FULL, finds every key it took with its value and updates values in place
+ */
+void check_dp_table(Checks &check, std::mt19937_64 &rng) {
+    TestTable table(TEST_TABLE_BYTES, TEST_KEY_LEN);
+    std::vector<TestTable::KEY> keys;
+    bool inserted = true;
+    while (keys.size() < table.capacity()) {
+        keys.push_back(test_key(keys.size(), rng));
+        const auto result = table.insert_or_find(keys.back(), keys.size());
+        inserted = inserted && result.status == TestTable::Status::INSERTED;
+    }
+    check(inserted && table.size() == keys.size(), "dp table insert", std::to_string(keys.size()) + " distinct keys");
+    check(table.insert_or_find(test_key(keys.size(), rng), 0).status == TestTable::Status::FULL, "dp table full",
+        "insert at capacity " + std::to_string(table.capacity()));
+    bool found = true;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        const auto result = table.insert_or_find(keys[i], 0);
+        found = found && result.status == TestTable::Status::FOUND && result.value == i + 1;
+    }
+    check(found && table.size() == keys.size(), "dp table find", "every inserted key, also at capacity");
+    auto other = keys[0];
+    other[TEST_KEY_LEN] = 0xFF;
+    check(table.insert_or_find(other, 0).value == 1, "dp table key length", "bytes past the key length are ignored");
+    bool updated = true;
+    for (std::size_t i = 0; i < keys.size(); i += 7) {
+        updated = updated && table.update(keys[i], ~i) && table.insert_or_find(keys[i], 0).value == ~i;
+    }
+    check(updated && !table.update(test_key(keys.size(), rng), 0), "dp table update", "present and absent keys");
+}
+
+/**
+ * @brief a mapped ShardedDPTable keeps its DPs across a sync and a reopen, and refuses a store made for another key length
+ */
+void check_dp_store(Checks &check, std::mt19937_64 &rng) {
+    const auto path = (std::filesystem::temp_directory_path() / ("sha2_test_store_" + std::to_string(rng()) + ".bin")).string();
+    std::vector<TestTable::KEY> keys;
+    {
+        TestStore store(TEST_TABLE_BYTES, TEST_SHARDS, TEST_KEY_LEN, path, false);
+        check(store.valid() && store.is_mapped(), "dp store create", path);
+        if (!store.valid()) {
+            return;
+        }
+        while (keys.size() < store.capacity() / 2) {
+            keys.push_back(test_key(keys.size(), rng));
+            store.shard(store.shard_of(keys.back())).insert_or_find(keys.back(), keys.size());
+        }
+        check(store.size() == keys.size() && store.sync(), "dp store sync", std::to_string(keys.size()) + " keys");
+    }
+    {
+        TestStore store(TEST_TABLE_BYTES / 2, TEST_SHARDS, TEST_KEY_LEN, path, true);
+        check(store.valid() && store.size() == keys.size(), "dp store reopen", std::to_string(store.size()) + " of " + std::to_string(keys.size()) + " keys");
+        bool found = store.valid();
+        for (std::size_t i = 0; found && i < keys.size(); ++i) {
+            const auto result = store.shard(store.shard_of(keys[i])).insert_or_find(keys[i], 0);
+            found = result.status == TestTable::Status::FOUND && result.value == i + 1;
+        }
+        check(found, "dp store resume", "every key with its value after the reopen");
+    }
+    check(!TestStore(TEST_TABLE_BYTES, TEST_SHARDS, TEST_KEY_LEN - 1, path, true).valid(), "dp store key length", "reopen with other keys");
+    check(!TestStore(TEST_TABLE_BYTES, TEST_SHARDS * 2, TEST_KEY_LEN, path, true).valid(), "dp store shards", "reopen with other shards");
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+/**
+ * @brief BlockedBloomFilter never rules out a key that was added, and rules out most of the others;
+ * the filter of a DPTable rebuilt on a region that already holds slots covers all of them
+ */
+void check_dp_filter(Checks &check, std::mt19937_64 &rng) {
+    BlockedBloomFilter filter(10 * TEST_FILTER_KEYS);
+    std::vector<uint64_t> hashes(TEST_FILTER_KEYS);
+    for (auto &h : hashes) {
+        h = rng();
+        filter.add(h);
+    }
+    check(std::all_of(hashes.begin(), hashes.end(), [&](uint64_t h) { return filter.may_contain(h); }), "bloom filter",
+        "no false negatives over " + std::to_string(hashes.size()) + " keys");
+    std::size_t false_positives = 0;
+    for (std::size_t i = 0; i < TEST_FILTER_KEYS; ++i) {
+        false_positives += filter.may_contain(rng());
+    }
+    const double rate = static_cast<double>(false_positives) / TEST_FILTER_KEYS;
+    check(rate < TEST_MAX_FALSE_POSITIVES, "bloom filter false positives", std::to_string(rate) + " of absent keys");
+
+    std::vector<uint8_t> region(TEST_TABLE_BYTES);
+    std::vector<TestTable::KEY> keys;
+    {
+        TestTable table(region.data(), region.size(), TEST_KEY_LEN);
+        while (keys.size() < table.capacity()) {
+            keys.push_back(test_key(keys.size(), rng));
+            table.insert_or_find(keys.back(), keys.size());
+        }
+        check(std::all_of(keys.begin(), keys.end(), [&](const auto &key) { return table.may_contain(key); }), "dp table filter",
+            "every inserted key");
+    }
+    const TestTable table(region.data(), region.size(), TEST_KEY_LEN);
+    check(table.size() == keys.size() && std::all_of(keys.begin(), keys.end(), [&](const auto &key) { return table.may_contain(key); }),
+        "dp table filter rebuild", "every key of the region");
+}
+
+/**
+ * @brief decode_dp_batch returns the DPs and the hash count given to encode_dp_batch, and rejects every truncated payload
+ */
+template <std::size_t N>
+void check_dp_codec(Checks &check, std::mt19937_64 &rng) {
+    for (std::size_t c = 0; c < TEST_CASES / 10; ++c) {
+        const std::size_t k = 1 + rng() % (N - 1);
+        std::vector<DP<N>> dps(rng() % 16);
+        for (auto &dp : dps) {
+            for (auto &b : dp.start) {
+                b = static_cast<uint8_t>(rng());
+            }
+            for (std::size_t i = 0; i < N - k; ++i) {
+                dp.key[i] = static_cast<uint8_t>(rng());
+            }
+            dp.length = static_cast<uint32_t>(rng() >> (rng() % 64));
+        }
+        const std::size_t hash_counts = rng();
+        const auto payload = encode_dp_batch(dps.data(), dps.size(), k, hash_counts);
+        const std::string what = std::to_string(dps.size()) + " DPs, N " + std::to_string(N) + ", k " + std::to_string(k);
+        std::size_t decoded_counts = 0;
+        std::vector<DP<N>> decoded;
+        bool ok = decode_dp_batch<N>(payload, k, decoded_counts, decoded) && decoded_counts == hash_counts && decoded.size() == dps.size();
+        for (std::size_t i = 0; ok && i < dps.size(); ++i) {
+            ok = decoded[i].start == dps[i].start && decoded[i].key == dps[i].key && decoded[i].length == dps[i].length;
+        }
+        check(ok, "dp batch round trip", what);
+        bool rejected = true;
+        for (std::size_t len = 0; len < payload.size(); ++len) {
+            const std::vector<uint8_t> truncated(payload.begin(), payload.begin() + len);
+            rejected = rejected && !decode_dp_batch<N>(truncated, k, decoded_counts, decoded);
+        }
+        check(rejected, "dp batch truncated", what);
+    }
+}
+
+template <typename HASH>
+void check_hash(Checks &check, std::string_view name, std::mt19937_64 &rng) {
+    check_compress_message<HASH>(check, name, rng);
+    check_compress_fixed<HASH>(check, name);
+    check_compress_lanes<HASH>(check, name, rng);
+    if constexpr (sizeof(typename HASH::WORDS::value_type) == 8) {
+        check_word64_pairs<HASH>(check, name, rng);
+    }
+}
+
+
+int main() {
+    Checks check;
+    std::mt19937_64 rng(TEST_SEED);
+    std::cerr << "host kernels:";
+    for (const auto &[kernel, backend] : SIMD_BACKEND_NAMES) {
+        std::cerr << " " << kernel << (simd_supported(backend) ? "" : " (not on this CPU, skipped)");
+    }
+    std::cerr << std::endl;
+    check_hash<SHA224>(check, "sha224", rng);
+    check_hash<SHA256>(check, "sha256", rng);
+    check_hash<SHA384>(check, "sha384", rng);
+    check_hash<SHA512>(check, "sha512", rng);
+    check_hash<SHA512_224>(check, "sha512-224", rng);
+    check_hash<SHA512_256>(check, "sha512-256", rng);
+    check_dp_table(check, rng);
+    check_dp_store(check, rng);
+    check_dp_filter(check, rng);
+    check_dp_codec<4>(check, rng);
+    check_dp_codec<8>(check, rng);
+    std::cerr << check.count() << " checks, " << check.failed() << " failed" << std::endl;
+    return static_cast<int>(std::min<std::size_t>(check.failed(), 255));
+}
@@ -0,0 +1,1254 @@
+/**
+ * @file vow.hpp
+ * @author Steven
+ * @brief Stage 1 of the VOW search: the device and host pipelines feeding one DP table, the continuous collision stream, the checkpoint of the DPs and walker states and the DP upload of a worker, shared by the command-line front-end, the benchmark and the searcher
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "sha2.hpp"
+#include "sha2_simd.hpp"
+#include "config.hpp"
+#include "checkpoint.hpp"
+#include "dp_net.hpp"
+#include "dp_table.hpp"
+#include "telemetry.hpp"
+#include "worker_pool.hpp"
+#include "walk.hpp"
+#include "stage_two.hpp"
+
+template <typename HASH, std::size_t N, bool PAIRED = false>
+class StageOneKernel;
+
+template <typename HASH, std::size_t N, bool PAIRED = false>
+class StageOneSeedKernel;
+
+
+/**
+ * @brief whether the start of the shorter of two chains ending at the same DP lies on the trail of the longer one
+ * 
+ * Such a "Robin Hood" pair shares one trail and gives no collision, stage 2 would only walk both chains to the same input.
+ * The longer chain is re-walked with the step of host stage 2 (compress_lanes with chain_backend), as the check runs in the merge (under merge_mutex).
+ */
+template<typename HASH, std::size_t N>
+bool is_robin_hood(const Walk<HASH> &walk, const DP_VALUE<N> &x, const DP_VALUE<N> &y) {
+    const auto backend = chain_backend(sizeof(typename HASH_WORDS<HASH>::value_type), 1);
+    const auto &longer = x.length >= y.length ? x : y;
+    const auto &shorter = x.length >= y.length ? y : x;
+    std::array<HASH_WORDS<HASH>, 1> hash = {hash_to_words<HASH>(longer.start)}, next;
+    for (auto steps = longer.length; steps > shorter.length; --steps) {
+        compress_lanes<HASH>(backend, walk.message, walk.midstate, hash.data(), next.data(), 1);
+        hash = next;
+    }
+    return point<N>(words_to_middle<HASH, N>(hash[0]), walk.last_mask) == shorter.start;
+}
+
+
+/**
+ * @brief merges one batch of DPs into the sharded DP table, one worker per shard
+ * 
+ * Every worker scans the batch and handles the DPs of its own shard with a single insert-or-find,
+ * so no locking is needed on the table. Unless `first_only`, every DP collision of the batch is collected
+ * and the shard keeps its chain for the next ones; otherwise the first DP collision found by any worker stops all of them.
+ * Robin Hood pairs are not collisions: the shard keeps the longer of the two chains and the merge goes on.
+ * A DP with the start of the chain stored at its key is that chain again (walked twice, e.g. over a resumed batch) and is only counted in `retraced`.
+ * The DPs the shard's filter cannot rule out are merged first, so a DP collision stops a first-only merge
+ * before the new DPs of the batch are written to the table.
+ * @param collisions        the DP collisions found are appended here
+ * @return                  the number of Robin Hood pairs in the batch
+ */
+template <typename HASH, std::size_t N>
+std::size_t merge_dps(
+    const Walk<HASH> &walk,
+    WorkerPool &pool,
+    DP_TABLE<N> &dp_table,
+    const DP<N> *dps,
+    std::size_t dp_count,
+    std::size_t k,
+    std::vector<StageOneResult<HASH, N>> &collisions,
+    bool first_only,
+    std::atomic<bool> &dp_table_full,
+    std::atomic<std::size_t> &retraced
+) {
+    using Status = typename DP_TABLE<N>::TABLE::Status;
+    std::atomic<bool> collided = false;
+    std::atomic<std::size_t> robin_hoods = 0;
+    std::mutex result_mutex;
+    pool.run([&](std::size_t shard) {
+        auto &table = dp_table.shard(shard);
+        auto merge = [&](const DP<N> &dp) {
+            const auto &key = dp.key;
+            const auto value = dp_value(dp);
+            const auto [status, other] = table.insert_or_find(key, value);
+            if (status == Status::FOUND && other.start == value.start) {
+                ++retraced;
+                return;
+            }
+            if (status == Status::FOUND && is_robin_hood<HASH, N>(walk, other, value)) {
+                if (value.length > other.length) {
+                    table.update(key, value);
+                }
+                ++robin_hoods;
+                return;
+            }
+            if (status == Status::FOUND) {
+                std::lock_guard lock(result_mutex);
+                if (!first_only || collisions.empty()) {
+                    StageOneResult<HASH, N> result;
+                    result.x = other.start;
+                    result.x_steps = other.length;
+                    result.y = dp.start;
+                    result.y_steps = dp.length;
+                    result.dp_collided = dp_hash<N>(dp.key, k);
+                    result.found = true;
+                    collisions.push_back(result);
+                }
+                collided = first_only;
+            } else if (status == Status::FULL) {
+                dp_table_full = true;
+            }
+        };
+        std::vector<std::size_t> absent;       // DPs of the shard the filter rules out
+        for (std::size_t i = 0; i < dp_count && !collided.load(std::memory_order_relaxed); ++i) {
+            if (dp_table.shard_of(dps[i].key) != shard) {
+                continue;
+            }
+            if (table.may_contain(dps[i].key)) {
+                merge(dps[i]);
+            } else {
+                absent.push_back(i);
+            }
+        }
+        // the filter is rechecked by the inserts, so a key twice in the batch is still found
+        for (std::size_t j = 0; j < absent.size() && !collided.load(std::memory_order_relaxed); ++j) {
+            merge(dps[absent[j]]);
+        }
+    });
+    return robin_hoods;
+}
+
+
+/**
+ * @brief continuous mode: runs stage 2 on every DP collision in the background while stage 1 goes on, and streams out the distinct collisions
+ * 
+ * Two chains merging once give the same collision at every later DP they share with a third chain,
+ * so collisions are deduplicated by their pair of inputs. Stage 1 is stopped once --collisions distinct ones were found.
+ */
+template <typename HASH, std::size_t N>
+class CollisionStream
+{
+
+public:
+
+    /**
+     * @param os_mutex          held while printing, so the stream does not cut into the lines of the stage-1 pipelines
+     * @param stop              set once enough distinct collisions were found
+     */
+    CollisionStream(const Config &config, std::mutex &os_mutex, std::atomic<bool> &stop, std::ostream &os):
+        config{config}, walk{make_walk<HASH>(config)}, os_mutex{os_mutex}, stop{stop}, os{os}, worker([this] { work(); }) {}
+
+    ~CollisionStream() {
+        close();
+    }
+
+    CollisionStream(const CollisionStream &) = delete;
+    CollisionStream &operator=(const CollisionStream &) = delete;
+
+    /**
+     * @brief queues one DP collision for stage 2
+     */
+    void push(const StageOneResult<HASH, N> &dp_collision) {
+        {
+            std::lock_guard lock(mutex);
+            pending.push_back(dp_collision);
+        }
+        cv.notify_one();
+    }
+
+    /**
+     * @brief runs stage 2 on the DP collisions still queued (unless enough collisions were found), then stops the worker thread
+     */
+    void close() {
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard lock(mutex);
+            closing = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    std::size_t distinct() const noexcept {
+        std::lock_guard lock(mutex);
+        return found.size();
+    }
+
+    std::size_t duplicates() const noexcept {
+        std::lock_guard lock(mutex);
+        return duplicate_count;
+    }
+
+    /**
+     * @brief hashes computed by stage 2 so far
+     */
+    std::size_t hash_counts() const noexcept {
+        std::lock_guard lock(mutex);
+        return stage_two_hash_counts;
+    }
+
+private:
+
+    const Config &config;
+    const Walk<HASH> walk;
+    std::mutex &os_mutex;
+    std::atomic<bool> &stop;
+    std::ostream &os;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<StageOneResult<HASH, N>> pending;
+    std::set<std::pair<std::vector<uint8_t>, std::vector<uint8_t>>> found;     // inputs of the distinct collisions, the smaller one first
+    std::size_t duplicate_count = 0;
+    std::size_t stage_two_hash_counts = 0;
+    bool closing = false;
+    std::thread worker;                 // last, it starts working on the members above
+
+    bool enough() const noexcept {
+        return config.collisions > 0 && found.size() >= config.collisions;
+    }
+
+    void work() {
+        std::ostream quiet(nullptr);    // the stage-2 trace of every collision would drown the stream
+        while (true) {
+            StageOneResult<HASH, N> dp_collision;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] { return closing || !pending.empty(); });
+                if (pending.empty() || enough()) {
+                    return;
+                }
+                dp_collision = pending.front();
+                pending.pop_front();
+            }
+            auto [x_state, y_state] = vow_stage_two<HASH, N>(config, walk, dp_collision, quiet);
+            const bool collided = x_state == y_state && x_state.in != y_state.in;
+            auto inputs = std::minmax(x_state.in, y_state.in);
+            std::size_t index = 0;
+            {
+                std::lock_guard lock(mutex);
+                stage_two_hash_counts += x_state.hash_count + y_state.hash_count;
+                if (!collided) {
+                    continue;
+                }
+                if (!found.emplace(inputs.first, inputs.second).second) {
+                    ++duplicate_count;
+                    continue;
+                }
+                index = found.size();
+                if (enough()) {
+                    stop = true;
+                }
+            }
+            std::lock_guard lock(os_mutex);
+            os << std::dec << "Collision " << index << ": ";
+            print_arr(os, inputs.first);
+            os << " ";
+            print_arr(os, inputs.second);
+            os << " (";
+            print_arr(os, x_state.out);
+            os << ")" << std::endl;
+        }
+    }
+
+};
+
+
+/**
+ * @brief connection of a worker to the DP server, with the seed range the server assigned
+ */
+struct DPUplink {
+    Socket socket;
+    std::size_t seed_base = 0;
+    std::vector<uint8_t> salt;              // the server's, every worker walks with it
+};
+
+/**
+ * @brief DP_BATCH payload: the sender's total hash count, then per DP its N start bytes, its N - K key bytes and its length as a varint
+ * 
+ * The K zero bytes of the digest are implied and the rest of the digest is not sent, 
+ * so a batch costs about 2N - K + 2 bytes per DP and the traffic follows the DP rate, not the hash rate.
+ */
+template <std::size_t N>
+std::vector<uint8_t> encode_dp_batch(const DP<N> *dps, std::size_t dp_count, std::size_t k, std::size_t hash_counts) {
+    WireWriter writer;
+    writer.bytes.reserve(16 + dp_count * (2 * N - k + 2));
+    writer.put_u64(hash_counts);
+    writer.put_u32(static_cast<uint32_t>(dp_count));
+    for (std::size_t i = 0; i < dp_count; ++i) {
+        writer.put_bytes(dps[i].start.data(), N);
+        writer.put_bytes(dps[i].key.data(), N - k);
+        writer.put_varint(dps[i].length);
+    }
+    return writer.bytes;
+}
+
+/**
+ * @return                  false if the payload is malformed
+ */
+template <std::size_t N>
+bool decode_dp_batch(const std::vector<uint8_t> &payload, std::size_t k, std::size_t &hash_counts, std::vector<DP<N>> &dps) {
+    WireReader reader(payload);
+    hash_counts = reader.get_u64();
+    const std::size_t dp_count = reader.get_u32();
+    if (!reader.ok() || dp_count > reader.remaining() / (2 * N - k + 1)) {
+        return false;
+    }
+    dps.assign(dp_count, DP<N>{});
+    for (auto &dp : dps) {
+        dp.key = {0};
+        reader.get_bytes(dp.start.data(), N);
+        reader.get_bytes(dp.key.data(), N - k);
+        const uint64_t length = reader.get_varint();
+        dp.length = static_cast<uint32_t>(length);
+        if (length > UINT32_MAX) {
+            return false;
+        }
+    }
+    return reader.ok() && reader.remaining() == 0;
+}
+
+
+/**
+ * @brief memory budget of the DP table, from --expected-dps if given
+ */
+template <std::size_t N>
+std::size_t dp_table_budget(const Config &config) noexcept {
+    return config.expected_dps > 0 ? DP_TABLE<N>::bytes_for(config.expected_dps, config.merge_threads, N - config.k) : config.dp_table_bytes;
+}
+
+/**
+ * @brief stage-1 host state shared by the pipelines of all devices (or, on the DP server, by the connections of all workers)
+ */
+template <typename HASH, std::size_t N>
+struct StageOneShared {
+    DP_TABLE<N> dp_table;
+    WorkerPool merge_pool;
+    std::mutex merge_mutex;                 // pipelines merge (and report) one at a time
+    std::atomic<bool> dp_table_full = false;
+    bool dp_table_full_reported = false;
+    std::atomic<bool> stop = false;         // set once a DP collided (or, in continuous mode, enough collisions were found or time ran out), here or on the DP server
+    std::vector<std::size_t> hash_counts;   // hashes computed by each device (or worker) up to its last merged batch
+    std::size_t resumed_hash_counts = 0;    // hashes of the workers of the runs before --resume (on the DP server)
+    std::size_t walkers = 0;                // walkers of every device (or, on the DP server, of every worker joined)
+    std::size_t robin_hoods = 0;            // DP collisions that turned out to be one chain starting on the other's trail
+    std::atomic<std::size_t> retraced = 0;  // DPs of a chain already stored, dropped
+    StageOneResult<HASH, N> result;
+    Walk<HASH> walk;                        // the walk of the campaign, for the Robin Hood checks of the merge
+    DPUplink *uplink;                       // if set, DPs are sent to the DP server instead of being merged here
+    Checkpointer *checkpoint = nullptr;     // if set, merged DPs are logged and walker states snapshotted there
+    std::unique_ptr<CollisionStream<HASH, N>> stream;       // continuous mode: every DP collision goes to stage 2 here and stage 1 goes on
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();     // --time-limit of continuous mode
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::size_t walked_hash_counts = 0;     // hashes of the batches merged since `started` (without those of the runs before --resume)
+    bool plan_drift_reported = false;
+    std::ofstream telemetry;                // --telemetry: one JSON line per merged batch
+
+    StageOneShared(const Config &config, std::size_t device_count, DPUplink *uplink = nullptr, std::ostream &os = std::cout):
+        dp_table(uplink || config.dp_store.empty()
+            ? DP_TABLE<N>(uplink ? 0 : dp_table_budget<N>(config), config.merge_threads, N - config.k)
+            : DP_TABLE<N>(dp_table_budget<N>(config), config.merge_threads, N - config.k, config.dp_store, config.resume)),
+        merge_pool(uplink ? 1 : config.merge_threads),
+        hash_counts(device_count, 0),
+        walk(make_walk<HASH>(config)),
+        uplink(uplink) {
+        if (config.continuous() && !uplink) {
+            stream = std::make_unique<CollisionStream<HASH, N>>(config, merge_mutex, stop, os);
+        }
+        if (config.time_limit > 0) {
+            deadline = std::chrono::steady_clock::now() + std::chrono::seconds(config.time_limit);
+        }
+    }
+
+    std::size_t total_hash_counts() const noexcept {
+        std::size_t total = resumed_hash_counts;
+        for (const auto count : hash_counts) {
+            total += count;
+        }
+        return total;
+    }
+};
+
+
+/**
+ * @brief merges DPs into the shared DP table and hands its DP collisions on
+ * 
+ * The first DP collision ends a single-collision campaign as shared.result, in continuous mode every one is queued for stage 2.
+ * @return                  the number of Robin Hood pairs in the DPs
+ */
+template <typename HASH, std::size_t N>
+std::size_t merge_shared(StageOneShared<HASH, N> &shared, const Config &config, const DP<N> *dps, std::size_t dp_count) {
+    std::vector<StageOneResult<HASH, N>> collisions;
+    const std::size_t robin_hoods = merge_dps<HASH, N>(shared.walk, shared.merge_pool, shared.dp_table, dps, dp_count, config.k, collisions, !shared.stream, shared.dp_table_full, shared.retraced);
+    shared.robin_hoods += robin_hoods;
+    for (const auto &collision : collisions) {
+        if (shared.stream) {
+            shared.stream->push(collision);
+        } else if (!shared.result.found) {
+            shared.result = collision;
+        }
+    }
+    return robin_hoods;
+}
+
+/**
+ * @brief merges one DP_BATCH payload (from the DP log or from a worker) into the DP table
+ * @param dp_count          set to the number of DPs in the payload
+ * @return                  false if the payload is malformed
+ */
+template <typename HASH, std::size_t N>
+bool merge_dp_batch(StageOneShared<HASH, N> &shared, const Config &config, const std::vector<uint8_t> &payload, std::size_t &hash_counts, std::size_t &dp_count) {
+    std::vector<DP<N>> dps;
+    if (!decode_dp_batch<N>(payload, config.k, hash_counts, dps)) {
+        return false;
+    }
+    dp_count = dps.size();
+    (void) merge_shared(shared, config, dps.data(), dps.size());
+    return true;
+}
+
+/**
+ * @return                  false if the DP store could not be created or reopened
+ */
+template <typename HASH, std::size_t N>
+bool report_dp_table(const StageOneShared<HASH, N> &shared, const Config &config, std::ostream &os) {
+    if (!shared.dp_table.valid()) {
+        os << std::endl;
+        std::cerr << "Cannot " << (config.resume ? "reopen" : "create") << " the DP store " << config.dp_store 
+            << (config.resume ? " (it must come from the same --n, --k and --merge-threads)" : "") << std::endl;
+        return false;
+    }
+    os << "Done (" << std::dec << shared.dp_table.capacity() << " DPs in " << shared.dp_table.memory_bytes() << " bytes";
+    if (shared.dp_table.is_mapped()) {
+        os << " mapped from " << config.dp_store << ", " << shared.dp_table.size() << " DPs stored";
+    }
+    os << ")" << std::endl;
+    return true;
+}
+
+/**
+ * @return                  false if the --telemetry file cannot be appended to
+ */
+template <typename HASH, std::size_t N>
+bool open_telemetry(StageOneShared<HASH, N> &shared, const Config &config) {
+    if (config.telemetry.empty()) {
+        return true;
+    }
+    shared.telemetry.open(config.telemetry, std::ios::app);
+    if (!shared.telemetry) {
+        std::cerr << "Cannot append the telemetry to " << config.telemetry << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief opens the checkpoint of the campaign and, on --resume, rebuilds the DP table from its DP log
+ */
+template <typename HASH, std::size_t N>
+bool open_checkpoint(Checkpointer &checkpoint, const Config &config, StageOneShared<HASH, N> &shared, std::ostream &os) {
+    WireWriter campaign;
+    put_campaign(campaign, config);
+    std::size_t frames = 0;
+    const bool ok = checkpoint.open(config.checkpoint_dir, campaign.bytes, config.resume, [&](const std::vector<uint8_t> &payload) {
+        std::size_t hash_counts = 0, dp_count = 0;
+        ++frames;
+        return merge_dp_batch(shared, config, payload, hash_counts, dp_count);
+    }, std::cerr);
+    if (!ok) {
+        return false;
+    }
+    if (config.resume) {
+        os << "Resumed " << std::dec << shared.dp_table.size() << " DPs from " << frames << " batches of the DP log in " << config.checkpoint_dir << std::endl;
+    } else {
+        checkpoint.save("salt.bin", config.salt);       // read back by settle_salt on --resume
+    }
+    shared.stop = shared.result.found;      // the previous run stopped right after merging the colliding batch
+    shared.checkpoint = &checkpoint;
+    return true;
+}
+
+/**
+ * @brief walker state snapshot of one device: threads, seed base, batches and steps per walker walked, then the raw (native-endian) state arrays
+ */
+template <typename HASH, std::size_t N>
+std::vector<uint8_t> encode_states(const StateBuffers<HASH, N> &states, std::size_t seed_base, std::size_t batch_count, std::size_t steps) {
+    WireWriter writer;
+    writer.put_u64(states.threads);
+    writer.put_u64(seed_base);
+    writer.put_u64(batch_count);
+    writer.put_u64(steps);
+    for (const auto &[data, size] : states.arrays()) {
+        writer.put_bytes(static_cast<const uint8_t *>(data), size);
+    }
+    return writer.bytes;
+}
+
+/**
+ * @brief how far the walkers of a resumed snapshot got
+ */
+struct ResumedWalk {
+    std::size_t batches = 0;                // 0 if the walks restart from their seeds
+    std::size_t steps = 0;                  // per walker
+};
+
+/**
+ * @brief uploads the snapshot `name` of the checkpoint into the device states if it was taken with the same walkers
+ * @param q                 queue of the device holding `states`, or nullptr for states in host memory
+ * @return                  batches and steps walked up to the snapshot, none if there is no matching snapshot
+ */
+template <typename HASH, std::size_t N>
+ResumedWalk resume_states(sycl::queue *q, const Checkpointer &checkpoint, const std::string &name, const StateBuffers<HASH, N> &states, std::size_t seed_base) {
+    std::vector<uint8_t> bytes;
+    if (!checkpoint.load(name, bytes)) {
+        return {};
+    }
+    std::size_t total_size = 0;
+    for (const auto &array : states.arrays()) {
+        total_size += array.second;
+    }
+    WireReader reader(bytes);
+    const std::size_t threads = reader.get_u64();
+    const std::size_t snapshot_seed_base = reader.get_u64();
+    const std::size_t batch_count = reader.get_u64();
+    const std::size_t steps = reader.get_u64();
+    if (!reader.ok() || threads != states.threads || snapshot_seed_base != seed_base || reader.remaining() != total_size) {
+        return {};
+    }
+    const uint8_t *pos = bytes.data() + bytes.size() - total_size;
+    for (const auto &[data, size] : states.arrays()) {
+        if (q) {
+            q->memcpy(data, pos, size);
+        } else {
+            std::memcpy(data, pos, size);
+        }
+        pos += size;
+    }
+    if (q) {
+        q->wait();
+    }
+    return {batch_count, steps};
+}
+
+
+/**
+ * @brief where the time of one merged batch went, in seconds (kernel and copy times are only profiled with --telemetry)
+ */
+struct BatchStats {
+    std::size_t hashes = 0;                 // hashes of the batch
+    double kernel = 0;                      // device execution of the batch kernel, or the walk on the host backend
+    double copy = 0;                        // device execution of the copies of the DP counters, the DPs and the hash counts (or the snapshot)
+    double wait = 0;                        // host blocked on those copies, and so on the end of the kernel
+    double merge = 0;                       // host merge into the DP table (or the send to the DP server)
+    double interval = 0;                    // since the previous batch of the same pipeline was merged
+};
+
+/**
+ * @brief device execution time of a command submitted to a queue created with enable_profiling
+ */
+inline double event_seconds(const sycl::event &event) {
+    const auto start = event.get_profiling_info<sycl::info::event_profiling::command_start>();
+    const auto end = event.get_profiling_info<sycl::info::event_profiling::command_end>();
+    return 1e-9 * static_cast<double>(end - start);
+}
+
+/**
+ * @brief appends the telemetry of one merged batch to --telemetry, with the DP rate against 2^-8K, the DP table load and the ETA of the expected VOW work
+ * @pre shared.merge_mutex is held
+ * @param source            `device` or, on the DP server, `worker`
+ */
+template <typename HASH, std::size_t N>
+void write_telemetry(
+    StageOneShared<HASH, N> &shared, 
+    const Config &config, 
+    std::string_view source, 
+    std::size_t index, 
+    std::size_t batch_count, 
+    std::size_t dp_count, 
+    const BatchStats &stats
+) {
+    shared.walked_hash_counts += stats.hashes;
+    if (!shared.telemetry.is_open()) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const std::size_t total = shared.total_hash_counts();
+    const std::size_t rate = hash_rate(shared.walked_hash_counts, elapsed_seconds(shared.started, now));
+    JsonLine line(shared.telemetry);
+    line.add("event", "batch")
+        .add("time_ms", std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count())
+        .add("source", source).add("index", index).add("batch", batch_count)
+        .add("batch_hashes", stats.hashes).add("hashes", total).add("hash_rate", rate)
+        .add("kernel_seconds", stats.kernel).add("copy_seconds", stats.copy).add("wait_seconds", stats.wait)
+        .add("merge_seconds", stats.merge).add("interval_seconds", stats.interval)
+        .add("dps", dp_count).add("dp_rate", stats.hashes > 0 ? static_cast<double>(dp_count) / static_cast<double>(stats.hashes) : 0.0)
+        .add("expected_dp_rate", std::ldexp(1.0, -static_cast<int>(config.dp_bits())));
+    if (shared.uplink) {
+        return;                 // the DP table and the campaign progress are on the DP server
+    }
+    line.add("dp_table_size", shared.dp_table.size())
+        .add("load_factor", shared.dp_table.capacity() > 0 ? static_cast<double>(shared.dp_table.size()) / static_cast<double>(shared.dp_table.capacity()) : 0.0)
+        .add("robin_hoods", shared.robin_hoods)
+        .add("retraced_dps", shared.retraced.load())
+        .add("collisions", shared.stream ? shared.stream->distinct() : std::size_t{shared.result.found});
+    if (config.collisions > 0) {
+        // the collisions of the DPs still open are found later, the ETA is that of the expected work
+        const double expected = expected_vow_work(config.collision_bits(), config.collisions, shared.walkers, config.dp_bits());
+        line.add("expected_hashes", expected).add("progress", static_cast<double>(total) / expected)
+            .add("eta_seconds", rate > 0 ? std::max(0.0, expected - static_cast<double>(total)) / static_cast<double>(rate) : -1.0);
+    } else {
+        line.add("eta_seconds", std::max(0.0, elapsed_seconds(now, shared.deadline)));
+    }
+}
+
+
+/**
+ * @brief with --k auto, reports once that the DPs come faster than the plan sized the DP table for
+ *
+ * The observed DPs per hash (short cycles and restarts add to 2^-8K) are projected onto the expected work of the campaign.
+ * @pre shared.merge_mutex is held
+ */
+template <typename HASH, std::size_t N>
+void report_plan_drift(StageOneShared<HASH, N> &shared, const Config &config, std::ostream &os) {
+    const std::size_t total = shared.total_hash_counts();
+    if (!config.plan || shared.plan_drift_reported || shared.dp_table.size() < 1024 || total == 0 || config.collisions == 0) {
+        return;
+    }
+    const double projected = static_cast<double>(shared.dp_table.size()) / static_cast<double>(total) * expected_vow_work(config.collision_bits(), config.collisions, shared.walkers, config.dp_bits());
+    if (projected > static_cast<double>(shared.dp_table.capacity())) {
+        os << ",\tDP rate above the plan: the DP table fills at about " << std::dec
+            << static_cast<std::size_t>(100 * static_cast<double>(shared.dp_table.capacity()) / projected) << "% of the expected work (increase --dp-table-bytes)";
+        shared.plan_drift_reported = true;
+    }
+}
+
+/**
+ * @brief merges (or, on a worker, sends) the DPs of one batch of a stage-1 pipeline, checkpoints them and reports the batch
+ * @pre shared.merge_mutex is held
+ * @param appended          DPs the walkers found in the batch, more than `dp_count` if the DP buffer overflowed
+ * @param hash_counts       hashes of the pipeline up to the batch
+ * @param snapshot          encoded walker states to checkpoint after the DPs (empty if no snapshot is due)
+ * @param stats             timings of the batch for the telemetry, the merge time is added here
+ * @return                  false once stage 1 is over
+ */
+template <typename HASH, std::size_t N>
+bool merge_batch(
+    StageOneShared<HASH, N> &shared, 
+    const Config &config, 
+    std::size_t device, 
+    std::size_t batch_count, 
+    const DP<N> *dps, 
+    std::size_t dp_count, 
+    std::size_t appended, 
+    std::size_t restarts, 
+    std::size_t hash_counts, 
+    const std::string &snapshot_name, 
+    std::vector<uint8_t> snapshot, 
+    BatchStats stats, 
+    std::ostream &os
+) {
+    shared.hash_counts[device] = hash_counts;
+    const auto merge_start = std::chrono::steady_clock::now();
+    os << std::dec << "Device: " << device << ",\tBatch: " << batch_count << ",\tTotal hash counts: " << shared.total_hash_counts();
+    if (appended > dp_count) {
+        os << ",\tDP buffer overflow: " << appended - dp_count << " DPs dropped (increase --dp-buffer-len)";
+    }
+    if (restarts > 0) {
+        os << ",\tTrail restarts: " << restarts;
+    }
+    if (shared.uplink) {
+        const auto payload = encode_dp_batch(dps, dp_count, config.k, shared.total_hash_counts());
+        if (!send_message(shared.uplink->socket, MessageType::DP_BATCH, payload)) {
+            os << ",\tlost the DP server" << std::endl;
+            shared.stop = true;
+            return false;
+        }
+        stats.merge = elapsed_seconds(merge_start, std::chrono::steady_clock::now());
+        write_telemetry(shared, config, "device", device, batch_count, dp_count, stats);
+        os << ",\tbatch DPs sent: " << dp_count << " (" << payload.size() << " bytes)" << std::endl;
+        return true;
+    }
+    const std::size_t robin_hoods = merge_shared(shared, config, dps, dp_count);
+    stats.merge = elapsed_seconds(merge_start, std::chrono::steady_clock::now());
+    write_telemetry(shared, config, "device", device, batch_count, dp_count, stats);
+    if (robin_hoods > 0) {
+        os << ",\tRobin Hoods: " << robin_hoods << " (" << shared.robin_hoods << " so far, not collisions)";
+    }
+    if (shared.dp_table_full && !shared.dp_table_full_reported) {
+        os << ",\tDP table full at " << shared.dp_table.size() << " DPs (increase --dp-table-bytes)";
+        shared.dp_table_full_reported = true;
+    }
+    report_plan_drift(shared, config, os);
+    if (shared.checkpoint) {
+        // the DPs of every batch up to a snapshot are queued before it (a mapped DP table already holds them, it is flushed instead)
+        if (!shared.dp_table.is_mapped()) {
+            shared.checkpoint->append_log(encode_dp_batch(dps, dp_count, config.k, hash_counts));
+        }
+        if (!snapshot.empty()) {
+            if (shared.dp_table.is_mapped()) {
+                shared.checkpoint->call([&dp_table = shared.dp_table] { return dp_table.sync(); });
+            }
+            shared.checkpoint->save(snapshot_name, std::move(snapshot));
+            os << (shared.checkpoint->healthy() ? ",\tcheckpoint queued" : ",\tcheckpoint writes failed");
+        }
+    }
+    if (shared.result.found) {
+        shared.stop = true;
+        return false;
+    }
+    if (std::chrono::steady_clock::now() >= shared.deadline) {
+        os << ",\ttime limit reached" << std::endl;
+        shared.stop = true;
+        return false;
+    }
+    os << ",\tDP chain counts: " << shared.dp_table.size() << ",\tbatch DPs: " << dp_count;
+    if (shared.stream) {
+        os << ",\tcollisions: " << shared.stream->distinct();
+    }
+    os << std::endl;
+    return true;
+}
+
+
+/**
+ * @tparam PAIRED           compute the 64-bit words as Word64Pair, see submit_walk
+ */
+template <typename HASH, std::size_t N, bool PAIRED>
+sycl::event submit_walk_as(
+    sycl::queue &q, 
+    const Walk<HASH> &walk, 
+    const StateBuffers<HASH, N> &states, 
+    const DPBuffer<HASH, N> &dps, 
+    std::size_t batch_size, 
+    std::size_t first_step, 
+    std::size_t work_group, 
+    const std::vector<sycl::event> &deps, 
+    std::optional<std::size_t> seed_base,
+    const sycl::kernel_bundle<sycl::bundle_state::executable> *kernels
+) {
+    const std::size_t threads = states.threads;
+    const auto midstate = walk.midstate;
+    return q.submit([&](sycl::handler& h) {
+        h.depends_on(deps);
+        if (kernels) {
+            h.use_kernel_bundle(*kernels);
+        } else {
+            set_walk_constants(h, walk);
+        }
+        auto step_batch = [=](Lanes<HASH, N> &walkers, std::size_t item, const Walk<HASH> &walk) {
+            for (std::size_t i = 1; i <= batch_size; ++i) {
+                walkers.template step<PAIRED>(walk, dps, first_step + i);
+            }
+            for (std::size_t l = 0; l < LANES; ++l) {
+                states.store(lane_walker(item, l, threads), walkers.lanes[l]);
+            }
+        };
+        if (seed_base) {
+            const std::size_t seed = *seed_base;
+            parallel_walk<StageOneSeedKernel<HASH, N, PAIRED>>(h, threads / LANES, work_group, [=](std::size_t item, sycl::kernel_handler kh) {
+                const auto walk = kernel_walk<HASH>(kh, midstate);
+                Lanes<HASH, N> walkers;
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    walkers.lanes[l] = State<HASH, N>{seed + lane_walker(item, l, threads), walk.start_key};
+                }
+                step_batch(walkers, item, walk);
+            });
+        } else {
+            parallel_walk<StageOneKernel<HASH, N, PAIRED>>(h, threads / LANES, work_group, [=](std::size_t item, sycl::kernel_handler kh) {
+                Lanes<HASH, N> walkers;
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    walkers.lanes[l] = states.load(lane_walker(item, l, threads));
+                }
+                step_batch(walkers, item, kernel_walk<HASH>(kh, midstate));
+            });
+        }
+    });
+}
+
+/**
+ * @brief queues one batch of the stage-1 kernel: every walker of `states` takes `batch_size` steps
+ * 
+ * With walk.paired the SHA-512 family runs the kernel instantiated on Word64Pair, with 32-bit arithmetic only.
+ * @param first_step        steps every walker took before the batch (they salt the restarts)
+ * @param seed_base         if set, the walkers start from their seeds instead of `states`
+ * @param work_group        work-items per work-group (0: the runtime picks), dividing threads / LANES
+ * @param kernels           the stage-1 kernels built with the constants of `walk` (see walk_kernels), or nullptr to specialize them here
+ */
+template <typename HASH, std::size_t N>
+sycl::event submit_walk(
+    sycl::queue &q, 
+    const Walk<HASH> &walk, 
+    const StateBuffers<HASH, N> &states, 
+    const DPBuffer<HASH, N> &dps, 
+    std::size_t batch_size, 
+    std::size_t first_step, 
+    std::size_t work_group, 
+    const std::vector<sycl::event> &deps, 
+    std::optional<std::size_t> seed_base = std::nullopt,
+    const sycl::kernel_bundle<sycl::bundle_state::executable> *kernels = nullptr
+) {
+    if constexpr (sizeof(typename HASH_WORDS<HASH>::value_type) == 8) {
+        if (walk.paired) {
+            return submit_walk_as<HASH, N, true>(q, walk, states, dps, batch_size, first_step, work_group, deps, seed_base, kernels);
+        }
+    }
+    return submit_walk_as<HASH, N, false>(q, walk, states, dps, batch_size, first_step, work_group, deps, seed_base, kernels);
+}
+
+
+/**
+ * @brief the device and host buffers of the stage-1 pipeline of one device, which a CollisionSearcher allocates once for all its searches
+ */
+template <typename HASH, std::size_t N>
+struct PipelineBuffers {
+    StateBuffers<HASH, N> states;
+    std::array<DPBuffer<HASH, N>, 2> device_dps;
+    std::array<DP<N> *, 2> host_dps = {nullptr, nullptr};
+    uint32_t *host_dp_cursors = nullptr;    // COUNTERS of each device DP buffer
+    const sycl::kernel_bundle<sycl::bundle_state::executable> *kernels = nullptr;     // stage-1 kernels built for the walk, or nullptr to specialize them per batch
+
+    static PipelineBuffers allocate(sycl::queue &q, std::size_t threads, std::size_t dp_buffer_len) {
+        PipelineBuffers buffers;
+        buffers.states = StateBuffers<HASH, N>::allocate(q, threads);
+        buffers.device_dps = {DPBuffer<HASH, N>::allocate(q, dp_buffer_len), DPBuffer<HASH, N>::allocate(q, dp_buffer_len)};
+        buffers.host_dps = {malloc_host<DP<N>>(dp_buffer_len, q), malloc_host<DP<N>>(dp_buffer_len, q)};
+        buffers.host_dp_cursors = malloc_host<uint32_t>(2 * DPBuffer<HASH, N>::COUNTERS, q);
+        return buffers;
+    }
+
+    void free(sycl::queue &q) const {
+        states.free(q);
+        for (std::size_t b = 0; b < 2; ++b) {
+            device_dps[b].free(q);
+            sycl::free(host_dps[b], q);
+        }
+        sycl::free(host_dp_cursors, q);
+    }
+};
+
+
+/**
+ * @brief stage 1 of one device as a two-deep pipeline
+ * 
+ * Batches alternate between two device DP buffers. While the device computes batch k+1, the host copies
+ * and merges the DPs of batch k; batch k+2 is queued behind both through event dependencies,
+ * so the host only ever waits for copies and never stalls the device.
+ * Every device runs its own pipeline on its own host thread and only synchronises with the others to merge,
+ * so a slow device never holds back a fast one.
+ * With a checkpoint, the walker states of a batch are snapshotted to host memory every --checkpoint-interval seconds
+ * by the copy that already runs between the batch and the next one, and written to disk by the checkpoint thread.
+ * With --k auto, a batch that fills more than half the DP buffer shortens the batches queued after it back to the planned fill.
+ * @param device            index of the device among the stage-1 devices
+ * @param seed_base         seed of the first walker of this device (seed ranges of the devices are disjoint)
+ * @param preallocated      buffers for the threads and DP buffer length of `config` to walk in (and the kernels built for `walk`, if set), 
+ *                          or nullptr to allocate them for this campaign
+ */
+template <typename HASH, std::size_t N>
+void vow_stage_one_device(
+    sycl::queue &q, 
+    std::size_t device,
+    std::size_t seed_base,
+    const Config &config, 
+    const Walk<HASH> &walk, 
+    StageOneShared<HASH, N> &shared,
+    const PipelineBuffers<HASH, N> *preallocated,
+    std::ostream &os
+) {
+    // kernels capture these by value
+    const std::size_t threads = config.threads_of(device);
+    const std::size_t work_group = config.work_group_of(device);
+    const std::size_t dp_buffer_len = config.dp_buffer_len;
+    std::size_t batch_size = config.batch_size_of(device);
+    std::array<std::size_t, 2> batch_sizes = {batch_size, batch_size};     // steps of the batch in flight in each DP buffer
+
+    const auto buffers = preallocated ? *preallocated : PipelineBuffers<HASH, N>::allocate(q, threads, dp_buffer_len);
+    const auto &states = buffers.states;
+    const auto &device_dps = buffers.device_dps;
+    const auto &host_dps = buffers.host_dps;
+    uint32_t *host_dp_cursors = buffers.host_dp_cursors;
+    std::array<sycl::event, 2> reset_events = {
+        q.memset(device_dps[0].cursor, 0, sizeof(uint32_t) * DPBuffer<HASH, N>::COUNTERS),
+        q.memset(device_dps[1].cursor, 0, sizeof(uint32_t) * DPBuffer<HASH, N>::COUNTERS)
+    };
+    q.wait();
+
+    const auto checkpoint = shared.checkpoint;
+    const std::string snapshot_name = "states-" + std::to_string(device) + ".bin";
+    std::array<StateBuffers<HASH, N>, 2> snapshots;
+    std::array<bool, 2> snapshot_taken = {false, false};
+    auto next_snapshot = std::chrono::steady_clock::now() + std::chrono::seconds(config.checkpoint_interval);
+    ResumedWalk resumed;
+    if (checkpoint) {
+        snapshots = {StateBuffers<HASH, N>::allocate_host(q, threads), StateBuffers<HASH, N>::allocate_host(q, threads)};
+        resumed = config.resume ? resume_states(&q, *checkpoint, snapshot_name, states, seed_base) : ResumedWalk{};
+    }
+    const std::size_t resumed_batches = resumed.batches;
+
+    // the states of batch k are snapshotted before batch k+1 starts updating them when a checkpoint is due
+    auto copy_snapshot = [&](std::size_t b, sycl::event kernel_event) {
+        snapshot_taken[b] = checkpoint && std::chrono::steady_clock::now() >= next_snapshot;
+        if (!snapshot_taken[b]) {
+            return kernel_event;
+        }
+        next_snapshot = std::chrono::steady_clock::now() + std::chrono::seconds(config.checkpoint_interval);
+        return q.submit([&](sycl::handler& h) {
+            h.depends_on(kernel_event);
+            const auto snapshot = snapshots[b];
+            h.parallel_for(sycl::range<1>(threads), [=](sycl::id<1> idx) {
+                snapshot.store(idx, states.load(idx));
+            });
+        });
+    };
+    // every walker takes batch_size steps, so the hashes of the device are counted from the steps queued
+    std::size_t steps = resumed.steps;
+    std::array<std::size_t, 2> batch_ends;                                  // steps per walker at the end of the batch in each DP buffer
+    auto submit_batch = [&](std::size_t b, const std::vector<sycl::event> &deps, std::optional<std::size_t> seed = std::nullopt) {
+        const auto event = submit_walk<HASH, N>(q, walk, states, device_dps[b], batch_size, steps, work_group, deps, seed, buffers.kernels);
+        steps += batch_size;
+        batch_ends[b] = steps;
+        return event;
+    };
+
+    // a resumed device continues the walks of its snapshot, the others start them from their seeds
+    std::array<sycl::event, 2> kernel_events, state_events;
+    kernel_events[0] = submit_batch(0, {reset_events[0]}, resumed_batches > 0 ? std::nullopt : std::optional<std::size_t>{seed_base});
+    state_events[0] = copy_snapshot(0, kernel_events[0]);
+    kernel_events[1] = submit_batch(1, {state_events[0], reset_events[1]});
+    state_events[1] = copy_snapshot(1, kernel_events[1]);
+    {
+        std::lock_guard lock(shared.merge_mutex);
+        os << std::dec << "Device " << device << ": " << threads << " walkers, " << batch_size << " steps per batch, " << (walk.paired ? "32-bit word pairs, " : "");
+        if (resumed_batches > 0) {
+            os << "resumed after batch " << resumed_batches << std::endl;
+        } else {
+            os << "initial batch submitted" << std::endl;
+        }
+    }
+    
+    const bool profiling = shared.telemetry.is_open() && q.has_property<sycl::property::queue::enable_profiling>();
+    auto last_merge = std::chrono::steady_clock::now();
+    for (std::size_t batch_count = resumed_batches + 1; !shared.stop; ++batch_count) {
+        const std::size_t b = (batch_count - resumed_batches - 1) % 2;
+
+        const auto wait_start = std::chrono::steady_clock::now();
+        auto cursor_event = q.submit([&](sycl::handler& h) {
+            h.depends_on(kernel_events[b]);
+            h.memcpy(host_dp_cursors + b * DPBuffer<HASH, N>::COUNTERS, device_dps[b].cursor, sizeof(uint32_t) * DPBuffer<HASH, N>::COUNTERS);
+        });
+        cursor_event.wait();
+        const std::size_t appended = host_dp_cursors[b * DPBuffer<HASH, N>::COUNTERS];
+        const std::size_t restarts = host_dp_cursors[b * DPBuffer<HASH, N>::COUNTERS + 1];
+        const std::size_t dp_count = std::min<std::size_t>(appended, dp_buffer_len);
+        auto dp_event = q.submit([&](sycl::handler& h) {
+            h.memcpy(host_dps[b], device_dps[b].data, sizeof(DP<N>) * dp_count);
+        });
+        dp_event.wait();
+        state_events[b].wait();
+        BatchStats stats;
+        stats.hashes = threads * batch_sizes[b];
+        stats.wait = elapsed_seconds(wait_start, std::chrono::steady_clock::now());
+        if (profiling) {
+            stats.kernel = event_seconds(kernel_events[b]);
+            stats.copy = event_seconds(cursor_event) + event_seconds(dp_event) + (snapshot_taken[b] ? event_seconds(state_events[b]) : 0);
+        }
+        const std::size_t hash_counts = threads * batch_ends[b];
+        // before batch_count + 2 reuses the snapshot buffer
+        std::vector<uint8_t> snapshot;
+        if (snapshot_taken[b]) {
+            snapshot = encode_states(snapshots[b], seed_base, batch_count, batch_ends[b]);
+        }
+
+        const std::size_t planned_size = batch_size;
+        if (config.plan && appended > dp_buffer_len / 2) {
+            batch_size = std::max<std::size_t>(1, batch_sizes[b] * (dp_buffer_len / PLAN_BUFFER_FILL) / appended);
+        }
+
+        // queue batch_count + 2 into the buffer just drained, behind batch_count + 1
+        batch_sizes[b] = batch_size;
+        reset_events[b] = q.memset(device_dps[b].cursor, 0, sizeof(uint32_t) * DPBuffer<HASH, N>::COUNTERS);
+        kernel_events[b] = submit_batch(b, {state_events[1 - b], reset_events[b]});
+        state_events[b] = copy_snapshot(b, kernel_events[b]);
+
+        // merge DPs and check for DP collision
+        std::lock_guard lock(shared.merge_mutex);
+        if (shared.stop) {
+            break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        stats.interval = elapsed_seconds(last_merge, now);
+        last_merge = now;
+        if (!merge_batch(shared, config, device, batch_count, host_dps[b], dp_count, appended, restarts, hash_counts, snapshot_name, std::move(snapshot), stats, os)) {
+            break;
+        }
+        if (batch_size != planned_size) {
+            os << "Device " << device << ": DP rate above the plan, " << batch_size << " steps per batch from batch " << batch_count + 2 << std::endl;
+        }
+    }
+
+    q.wait();                   // the batches still in flight
+    if (!preallocated) {
+        buffers.free(q);
+    }
+    if (checkpoint) {
+        snapshots[0].free(q);
+        snapshots[1].free(q);
+    }
+}
+
+
+/**
+ * @brief the --host-simd kernel for HASH (`auto`: the fastest one this CPU runs)
+ * @return                  nothing if this CPU does not run it or it does not cover HASH
+ */
+template <typename HASH>
+std::optional<SIMD_BACKEND> host_backend(const Config &config) noexcept {
+    constexpr std::size_t word_size = sizeof(typename HASH_WORDS<HASH>::value_type);
+    if (config.host_simd == "auto") {
+        return best_simd_backend(word_size);
+    }
+    for (const auto &[name, backend] : SIMD_BACKEND_NAMES) {
+        if (config.host_simd == name && simd_supported(backend) && (backend != SIMD_BACKEND::SHA_NI || word_size == 4)) {
+            return backend;
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief stage 1 on the host CPU with the multi-buffer kernels of sha2_simd.hpp (--devices host)
+ * 
+ * Every batch, each host thread walks its share of the walkers in groups of SIMD_MAX_LANES, one compress_lanes call per step,
+ * and the DPs of all threads are merged like the DPs of a device batch.
+ * The states are kept in host memory with the layout of StateBuffers, so they are checkpointed and resumed like a device's.
+ * @param backend           kernel to walk with, supported by this CPU
+ */
+template <typename HASH, std::size_t N>
+void vow_stage_one_host(
+    SIMD_BACKEND backend,
+    std::size_t device,
+    std::size_t seed_base,
+    const Config &config, 
+    const Walk<HASH> &walk, 
+    StageOneShared<HASH, N> &shared,
+    std::ostream &os
+) {
+    using word_t = typename HASH_WORDS<HASH>::value_type;
+    constexpr std::size_t WORDS = StateBuffers<HASH, N>::WORDS;
+    const std::size_t threads = config.threads_of(device);
+    const std::size_t batch_size = config.batch_size_of(device);
+
+    std::vector<uint32_t> steps_since_last_dp(threads);
+    std::vector<word_t> start(WORDS * threads), hash(WORDS * threads);
+    const StateBuffers<HASH, N> states{threads, steps_since_last_dp.data(), start.data(), hash.data()};
+
+    const auto checkpoint = shared.checkpoint;
+    const std::string snapshot_name = "states-" + std::to_string(device) + ".bin";
+    auto next_snapshot = std::chrono::steady_clock::now() + std::chrono::seconds(config.checkpoint_interval);
+    const auto resumed = checkpoint && config.resume ? resume_states<HASH, N>(nullptr, *checkpoint, snapshot_name, states, seed_base) : ResumedWalk{};
+    const std::size_t resumed_batches = resumed.batches;
+    std::size_t steps = resumed.steps;      // per walker, before the batch
+    if (resumed_batches == 0) {
+        for (std::size_t idx = 0; idx < threads; ++idx) {
+            states.store(idx, State<HASH, N>{seed_base + idx, walk.start_key});
+        }
+    }
+
+    WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    const std::size_t share = CEIL_DIV(CEIL_DIV(threads, SIMD_MAX_LANES), pool.size()) * SIMD_MAX_LANES;
+    std::vector<std::vector<DP<N>>> thread_dps(pool.size());
+    std::vector<std::size_t> thread_restarts(pool.size());
+    {
+        std::lock_guard lock(shared.merge_mutex);
+        os << "Device " << device << ": host, " << simd_backend_name(backend) << " kernel on " << pool.size() << " threads, " 
+            << threads << " walkers, " << batch_size << " steps per batch";
+        if (resumed_batches > 0) {
+            os << ", resumed after batch " << resumed_batches;
+        }
+        os << std::endl;
+    }
+
+    std::vector<DP<N>> dps;
+    auto last_merge = std::chrono::steady_clock::now();
+    for (std::size_t batch_count = resumed_batches + 1; !shared.stop; ++batch_count) {
+        const auto walk_start = std::chrono::steady_clock::now();
+        pool.run([&](std::size_t t) {
+            thread_dps[t].clear();
+            thread_restarts[t] = 0;
+            const HostDPs<N> sink{&thread_dps[t], &thread_restarts[t]};
+            const std::size_t end = std::min(threads, (t + 1) * share);
+            for (std::size_t first = t * share; first < end; first += SIMD_MAX_LANES) {
+                const std::size_t count = std::min(SIMD_MAX_LANES, end - first);
+                std::array<State<HASH, N>, SIMD_MAX_LANES> walkers;
+                std::array<HASH_WORDS<HASH>, SIMD_MAX_LANES> prev, next;
+                for (std::size_t l = 0; l < count; ++l) {
+                    walkers[l] = states.load(first + l);
+                }
+                for (std::size_t i = 1; i <= batch_size; ++i) {
+                    for (std::size_t l = 0; l < count; ++l) {
+                        prev[l] = walkers[l].hash;
+                    }
+                    compress_lanes<HASH>(backend, walk.message, walk.midstate, prev.data(), next.data(), count);
+                    for (std::size_t l = 0; l < count; ++l) {
+                        walkers[l].advance(next[l], walk, sink, steps + i);
+                    }
+                }
+                for (std::size_t l = 0; l < count; ++l) {
+                    states.store(first + l, walkers[l]);
+                }
+            }
+        });
+        BatchStats stats;
+        stats.hashes = threads * batch_size;
+        stats.kernel = elapsed_seconds(walk_start, std::chrono::steady_clock::now());
+        dps.clear();
+        std::size_t restarts = 0;
+        for (std::size_t t = 0; t < pool.size(); ++t) {
+            dps.insert(dps.end(), thread_dps[t].begin(), thread_dps[t].end());
+            restarts += thread_restarts[t];
+        }
+        steps += batch_size;
+        const std::size_t hash_counts = threads * steps;
+        std::vector<uint8_t> snapshot;
+        if (checkpoint && std::chrono::steady_clock::now() >= next_snapshot) {
+            snapshot = encode_states(states, seed_base, batch_count, steps);
+            next_snapshot = std::chrono::steady_clock::now() + std::chrono::seconds(config.checkpoint_interval);
+        }
+
+        std::lock_guard lock(shared.merge_mutex);
+        const auto now = std::chrono::steady_clock::now();
+        stats.interval = elapsed_seconds(last_merge, now);
+        last_merge = now;
+        if (shared.stop || !merge_batch(shared, config, device, batch_count, dps.data(), dps.size(), dps.size(), restarts, hash_counts, snapshot_name, std::move(snapshot), stats, os)) {
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief the DP collision found by stage 1
+ */
+template <typename HASH, std::size_t N>
+void print_stage_one_result(const Config &config, const StageOneResult<HASH, N> &result, std::ostream &os) {
+    os << "\nStage 1 ended with the following DP collision:";
+    os << "\nDP Collided: ";
+    print_arr(os, result.dp_collided);
+    os << "\nX (" << std::dec << result.x_steps << " steps before DP Collided):\n";
+    print_arr(os, format_input<N>(config, result.x));
+    os << "\nY (" << std::dec << result.y_steps << " steps before DP Collided):\n";
+    print_arr(os, format_input<N>(config, result.y));
+    os << std::endl;
+}
+
+
+/**
+ * @brief the result of stage 1 once every pipeline stopped, in continuous mode after stage 2 of the DP collisions still queued
+ */
+template <typename HASH, std::size_t N>
+StageOneResult<HASH, N> finish_stage_one(StageOneShared<HASH, N> &shared, const Config &config, std::ostream &os) {
+    auto &result = shared.result;
+    result.total_hash_counts = shared.total_hash_counts();
+    if (!shared.stream) {
+        print_stage_one_result(config, result, os);
+        return result;
+    }
+    shared.stream->close();
+    result.total_hash_counts += shared.stream->hash_counts();
+    os << std::dec << "\nStage 1 ended with " << shared.stream->distinct() << " distinct collisions ("
+        << shared.stream->duplicates() << " found again, " << shared.robin_hoods << " Robin Hoods skipped, " 
+        << shared.retraced << " retraced DPs dropped)" << std::endl;
+    return result;
+}
+
+
+/**
+ * @brief stage 1 on all devices at once, every device pipeline feeding the same DP table
+ * @param uplink            if set, run as a worker of the DP server: walk the assigned seed range and send the DPs to the server until it says STOP
+ * @param buffers           if set, the preallocated pipeline buffers of every queue
+ * @return                  the DP collision (never found by a worker), or nothing if the checkpoint cannot be opened
+ */
+template <typename HASH, std::size_t N>
+std::optional<StageOneResult<HASH, N>> vow_stage_one(
+    std::vector<sycl::queue> &queues, 
+    const Config &config, 
+    const Walk<HASH> &walk, 
+    DPUplink *uplink = nullptr, 
+    std::ostream &os=std::cout,
+    const std::vector<PipelineBuffers<HASH, N>> *buffers = nullptr
+) {
+
+    os << "Allocating DP table: ";
+    const auto backend = config.devices == "host" ? host_backend<HASH>(config) : std::nullopt;
+    StageOneShared<HASH, N> shared(config, backend ? 1 : queues.size(), uplink, os);
+    Checkpointer checkpoint;
+    if (!report_dp_table(shared, config, os) || !open_telemetry(shared, config) 
+        || (!config.checkpoint_dir.empty() && !open_checkpoint(checkpoint, config, shared, os))) {
+        return std::nullopt;
+    }
+
+    // the server only ever sends STOP after the handshake, a closed connection has the same effect
+    std::thread stop_listener;
+    if (uplink) {
+        stop_listener = std::thread([&] {
+            Message message;
+            while (recv_message(uplink->socket, message) && message.type != MessageType::STOP);
+            shared.stop = true;
+        });
+    }
+
+    for (std::size_t d = 0; d < queues.size(); ++d) {
+        shared.walkers += config.threads_of(d);
+    }
+    if (backend) {
+        shared.walkers += config.threads_of(0);
+    }
+    std::vector<std::thread> pipelines;
+    std::size_t seed_base = uplink ? uplink->seed_base : 0;
+    for (std::size_t d = 0; d < queues.size() && !shared.stop; ++d) {
+        pipelines.emplace_back([&, d, seed_base] {
+            vow_stage_one_device<HASH, N>(queues[d], d, seed_base, config, device_walk(walk, config, queues[d].get_device()), shared, buffers ? &(*buffers)[d] : nullptr, os);
+        });
+        seed_base += config.threads_of(d);
+    }
+    if (backend) {
+        pipelines.emplace_back([&, seed_base] {
+            vow_stage_one_host<HASH, N>(*backend, 0, seed_base, config, walk, shared, os);
+        });
+    }
+    for (auto &pipeline : pipelines) {
+        pipeline.join();
+    }
+    if (uplink) {
+        uplink->socket.shutdown();
+        stop_listener.join();
+        os << "\nStage 1 stopped by the DP server after " << std::dec << shared.total_hash_counts() << " hashes" << std::endl;
+        return shared.result;
+    }
+
+    return finish_stage_one(shared, config, os);
+}
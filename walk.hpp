@@ -0,0 +1,637 @@
+/**
+ * @file walk.hpp
+ * @author Steven
+ * @brief The walk shared by both stages of the VOW search: the compile-time switches, the message layout and its specialization constants, the DP records and the walker state storage of the kernels
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <sycl/sycl.hpp>
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <random>
+#include <utility>
+#include <vector>
+#include "sha2.hpp"
+#include "sha2_simd.hpp"
+#include "config.hpp"
+#include "dp_table.hpp"
+
+constexpr static auto MIDSTATE = true;                    // Compress the full prefix blocks once on the host and only the remaining blocks per step
+constexpr static auto TRUNCATE = true;                    // Only compute and serialise the first N bytes of the digest (the rest never affects the walk)
+constexpr auto LANES = 1;                          // Number of independent chains each work-item advances in lockstep (threads walkers on threads / LANES work-items)
+using SUPPORTED_N = std::index_sequence<3, 4, 5, 6, 7, 8, 9>;  // Partial collision lengths with pre-instantiated kernels for every hash function (each one adds to the compile time)
+constexpr std::size_t MAX_TAIL_BLOCKS = 2;         // Capacity in blocks of the run-time message layout (bounds the prefix bytes after the midstate plus N plus the suffix)
+constexpr std::size_t PLAN_BUFFER_FILL = 4;         // --k auto sizes the DP buffers for this many batches of DPs at the expected DP rate
+
+template <typename HASH>
+using HASH_OUT = std::array<uint8_t, HASH::OUTPUT_SIZE>;
+
+/**
+ * @brief the N variable bytes of an input, between the prefix and the suffix
+ */
+template <std::size_t N>
+using MIDDLE = std::array<uint8_t, N>;
+
+template <typename HASH>
+using HASH_WORDS = typename HASH::WORDS;
+
+template <typename HASH>
+using MESSAGE = typename HASH::template FIXED_MESSAGE<MAX_TAIL_BLOCKS>;
+
+// the message layout only depends on the word size, so SHA-224/SHA-256 and the SHA-512 variants each share one specialization constant
+constexpr sycl::specialization_id<MESSAGE<SHA256>> MESSAGE_256_SPEC;
+constexpr sycl::specialization_id<MESSAGE<SHA512>> MESSAGE_512_SPEC;
+constexpr sycl::specialization_id<std::size_t> DP_BITS_SPEC;
+constexpr sycl::specialization_id<uint8_t> LAST_MASK_SPEC;
+constexpr sycl::specialization_id<uint32_t> MAX_TRAIL_SPEC;
+constexpr sycl::specialization_id<uint64_t> START_KEY_SPEC;
+
+template <typename HASH>
+constexpr const auto &MESSAGE_SPEC = [] () -> const auto & {
+    if constexpr (sizeof(typename HASH_WORDS<HASH>::value_type) == 4) {
+        return MESSAGE_256_SPEC;
+    } else {
+        return MESSAGE_512_SPEC;
+    }
+}();
+
+/**
+ * @brief the run-time constants of a walk step
+ * 
+ * Kernels receive the message layout, the DP mask and the point mask as specialization constants, so a JIT-compiled kernel 
+ * folds the prefix and suffix words and the DP check as if they were compile-time constants.
+ * A bit-granular N only takes the leading bits of the last variable byte into the message (the layout masks the others off),
+ * and a bit-granular K tests the leading bits of the digest, so neither adds a branch to the step.
+ * The salt sits in the constant part of the variable message words, so a salted step costs no more than an unsalted one.
+ */
+template <typename HASH>
+struct Walk {
+    MESSAGE<HASH> message;                  // layout of `prefix tail || N variable bytes || suffix`
+    HASH_WORDS<HASH> midstate = {0};        // chaining value after the full prefix blocks, computed once on the host
+    std::size_t dp_bits = 0;                // DP condition length in bits
+    uint8_t last_mask = 0xFF;               // bits of the last of the N middle bytes that belong to the point
+    uint32_t max_trail = UINT32_MAX;        // steps without a DP after which a walker restarts
+    bool paired = false;                    // the kernels compute the 64-bit words as Word64Pair (picks the kernel on the host, not a kernel constant)
+    uint64_t start_key = 0;                 // key of the start-point generator, from the salt
+};
+
+/**
+ * @brief bits of the last of the `n` middle bytes among the first `bits` bits of the digest
+ * @pre 8 (n - 1) < bits <= 8 n
+ */
+constexpr static uint8_t last_byte_mask(std::size_t n, std::size_t bits) noexcept {
+    return static_cast<uint8_t>(0xFF << (8 * n - bits));
+}
+
+/**
+ * @brief the point of a walk: `middle` without the bits past N of its last byte
+ */
+template<std::size_t N>
+constexpr static MIDDLE<N> point(MIDDLE<N> middle, uint8_t last_mask) noexcept {
+    middle[N - 1] &= last_mask;
+    return middle;
+}
+
+/**
+ * @brief the splitmix64 finalizer, a bijection of the 64-bit words
+ */
+constexpr static uint64_t mix64(uint64_t x) noexcept {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief key of the start-point generator of a campaign walking with `salt` (0 without a salt)
+ */
+static uint64_t salt_key(const std::vector<uint8_t> &salt) noexcept {
+    uint64_t key = 0;
+    for (const uint8_t byte : salt) {
+        key = mix64(key ^ byte) + 0x9E3779B97F4A7C15ull;
+    }
+    return key;
+}
+
+/**
+ * @brief a fresh salt of `n` bytes
+ */
+inline std::vector<uint8_t> draw_salt(std::size_t n) {
+    std::random_device device;
+    std::vector<uint8_t> salt(n);
+    for (auto &byte : salt) {
+        byte = static_cast<uint8_t>(device());
+    }
+    return salt;
+}
+
+/**
+ * @brief the start point of walker `seed`, from a counter-based generator rather than a stream shared by the walkers
+ *
+ * Word w of the point is the (w + 1)-th splitmix64 output after the state mix64(key ^ seed), so every seed gets its own stream
+ * and the disjoint seed ranges of the devices and of the DP server's workers give pseudo-random, never repeated start points.
+ */
+template<std::size_t N>
+constexpr static MIDDLE<N> start_point(uint64_t key, uint64_t seed) noexcept {
+    MIDDLE<N> middle = {0};
+    const uint64_t state = mix64(key ^ seed);
+    uint64_t word = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        if (i % 8 == 0) {
+            word = mix64(state + 0x9E3779B97F4A7C15ull * (i / 8 + 1));
+        }
+        middle[i] = static_cast<uint8_t>(word >> (8 * (i % 8)));
+    }
+    return middle;
+}
+
+/**
+ * @brief default trail cap, 20 times the expected 2^K steps between two DPs (a longer trail is almost surely stuck in a cycle without DPs)
+ */
+static uint32_t default_max_trail(std::size_t dp_bits) noexcept {
+    return dp_bits >= 28 ? UINT32_MAX : static_cast<uint32_t>(std::min<uint64_t>(uint64_t{20} << dp_bits, UINT32_MAX));
+}
+
+template <typename HASH>
+static std::size_t midstate_len(const Config &config) noexcept {
+    return MIDSTATE ? config.prefix.size() / HASH::BLOCK_SIZE * HASH::BLOCK_SIZE : 0;
+}
+
+/**
+ * @brief whether the prefix bytes after the midstate, the N variable bytes and the suffix fit in the MAX_TAIL_BLOCKS layout
+ */
+template <typename HASH>
+static bool walk_fits(const Config &config) noexcept {
+    return MESSAGE<HASH>::fits(config.prefix.size() - midstate_len<HASH>(config), config.n, config.suffix.size());
+}
+
+/**
+ * @brief builds the walk constants on the host
+ * @pre walk_fits<HASH>(config)
+ */
+template <typename HASH>
+static Walk<HASH> make_walk(const Config &config) noexcept {
+    const auto offset = midstate_len<HASH>(config);
+    Walk<HASH> walk;
+    HASH hash_func;
+    hash_func.update(config.prefix.data(), offset);
+    walk.midstate = hash_func.chaining_value();
+    walk.message = HASH::template fixed_message<MAX_TAIL_BLOCKS>(
+        config.prefix.data() + offset, config.prefix.size() - offset, 
+        config.n, 
+        config.suffix.data(), config.suffix.size(), 
+        offset,
+        last_byte_mask(config.n, config.collision_bits()),
+        config.salt.empty() ? nullptr : config.salt.data()
+    );
+    walk.start_key = salt_key(config.salt);
+    walk.dp_bits = config.dp_bits();
+    walk.last_mask = last_byte_mask(config.n, config.collision_bits());
+    walk.max_trail = config.max_trail > 0 ? static_cast<uint32_t>(std::min<std::size_t>(config.max_trail, UINT32_MAX)) : default_max_trail(walk.dp_bits);
+    return walk;
+}
+
+/**
+ * @brief sets the walk constants on a command group, or on an input kernel bundle to build the kernels of one layout ahead of their batches
+ */
+template <typename HASH, typename TARGET>
+static void set_walk_constants(TARGET &h, const Walk<HASH> &walk) {
+    h.template set_specialization_constant<MESSAGE_SPEC<HASH>>(walk.message);
+    h.template set_specialization_constant<DP_BITS_SPEC>(walk.dp_bits);
+    h.template set_specialization_constant<LAST_MASK_SPEC>(walk.last_mask);
+    h.template set_specialization_constant<MAX_TRAIL_SPEC>(walk.max_trail);
+    h.template set_specialization_constant<START_KEY_SPEC>(walk.start_key);
+}
+
+template <typename HASH>
+static Walk<HASH> kernel_walk(const sycl::kernel_handler &kh, const HASH_WORDS<HASH> &midstate) noexcept {
+    Walk<HASH> walk{
+        kh.get_specialization_constant<MESSAGE_SPEC<HASH>>(), 
+        midstate, 
+        kh.get_specialization_constant<DP_BITS_SPEC>(),
+        kh.get_specialization_constant<LAST_MASK_SPEC>(),
+        kh.get_specialization_constant<MAX_TRAIL_SPEC>()
+    };
+    walk.start_key = kh.get_specialization_constant<START_KEY_SPEC>();
+    return walk;
+}
+
+/**
+ * @brief whether a device likely emulates 64-bit integer arithmetic
+ * 
+ * SYCL has no aspect for native 64-bit integer ALUs. GPUs without fp64 (the Intel Xe-LP and Xe-HPG class) emulate 64-bit adds and rotates too,
+ * and a device without a native long vector width says so outright.
+ */
+inline bool weak_int64(const sycl::device &device) {
+    return device.is_gpu() && (!device.has(sycl::aspect::fp64) || device.get_info<sycl::info::device::native_vector_width_long>() == 0);
+}
+
+/**
+ * @brief the walk as `device` runs it, with the 64-bit words of the SHA-512 family as 32-bit pairs if --word-pairs picks them there
+ */
+template <typename HASH>
+static Walk<HASH> device_walk(const Walk<HASH> &walk, const Config &config, const sycl::device &device) {
+    Walk<HASH> on_device = walk;
+    on_device.paired = sizeof(typename HASH_WORDS<HASH>::value_type) == 8 
+        && (config.word_pairs == "on" || (config.word_pairs == "auto" && weak_int64(device)));
+    return on_device;
+}
+
+template<typename BYTES>
+void print_arr(std::ostream &os, const BYTES &arr) noexcept{
+    for (auto byte : arr)
+        os << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+}
+
+/**
+ * @brief the input `prefix || (first N bytes of middle XOR salt) || suffix`, with the bits past the collision length cleared like the walk does
+ */
+template<std::size_t N>
+static std::vector<uint8_t> format_input(const Config &config, const auto &middle) {
+    std::vector<uint8_t> input;
+    input.reserve(config.prefix.size() + N + config.suffix.size());
+    input.insert(input.end(), config.prefix.begin(), config.prefix.end());
+    input.insert(input.end(), middle.begin(), middle.begin() + N);
+    input.insert(input.end(), config.suffix.begin(), config.suffix.end());
+    for (std::size_t i = 0; i < config.salt.size() && i < N; ++i) {
+        input[config.prefix.size() + i] ^= config.salt[i];
+    }
+    input[config.prefix.size() + N - 1] &= last_byte_mask(N, config.collision_bits());
+    return input;
+}
+
+template<typename HASH>
+constexpr static auto words_to_hash(const HASH_WORDS<HASH> &words) noexcept {
+    HASH_OUT<HASH> hash;
+    HASH::serialize(hash.data(), words);
+    return hash;
+}
+
+template<typename HASH, std::size_t N>
+constexpr static auto words_to_middle(const HASH_WORDS<HASH> &words) noexcept {
+    static_assert(N <= HASH::OUTPUT_SIZE, "N must not exceed the digest size");
+    const auto hash = words_to_hash<HASH>(words);
+    MIDDLE<N> middle;
+    std::copy(hash.begin(), hash.begin() + N, middle.begin());
+    return middle;
+}
+
+template<typename HASH, std::size_t LEN>
+constexpr static auto hash_to_words(const std::array<uint8_t, LEN> &hash) noexcept {
+    using word_t = typename HASH_WORDS<HASH>::value_type;
+    std::array<uint8_t, 8 * sizeof(word_t)> bytes = {0};
+    std::copy(hash.begin(), hash.end(), bytes.begin());
+    return message_to_blocks<word_t, 8>(bytes.data());
+}
+
+/**
+ * @brief whether the first `bits` bits of the digest are zero, with the words ORed together instead of tested one by one
+ */
+template<typename HASH>
+constexpr static bool leading_bits_zero(const HASH_WORDS<HASH> &words, const std::size_t bits) noexcept {
+    using word_t = typename HASH_WORDS<HASH>::value_type;
+    constexpr std::size_t WORD_BITS = 8 * sizeof(word_t);
+    word_t set = 0;
+    for (std::size_t i = 0; i < bits / WORD_BITS; ++i) {
+        set |= words[i];
+    }
+    const std::size_t rest = bits % WORD_BITS;
+    set |= rest != 0 ? words[bits / WORD_BITS] >> (WORD_BITS - rest) : 0;
+    return set == 0;
+}
+
+/**
+ * @brief a DP is keyed on its point bytes K..N-1 (the first K whole bytes are zero by definition), moved to the front and packed to N - K bytes by the DP table
+ */
+template<std::size_t N>
+using DP_KEY = std::array<uint8_t, N>;
+
+/**
+ * @brief compact DP record, the same on the device, over the transfer and (as key and DP_VALUE) in the DP table
+ * 
+ * Only the N digest bytes that feed the walk matter, and the prefix and suffix are constants,
+ * so a record is the chain start and the DP key instead of the full input and digest.
+ */
+template<std::size_t N>
+struct DP {
+    MIDDLE<N> start;                            // middle bytes of the input at the start of the chain ending at this DP
+    DP_KEY<N> key;                              // digest bytes K..N-1 (the rest is zero)
+    uint32_t length = 0;                        // steps from the chain start to this DP
+};
+
+/**
+ * @brief the chain ending at a DP: the middle bytes of its start input and its length
+ */
+template<std::size_t N>
+struct DP_VALUE {
+    MIDDLE<N> start;
+    uint32_t length;
+};
+
+template<std::size_t N>
+using DP_TABLE = ShardedDPTable<N, DP_VALUE<N>>;
+
+template<std::size_t N>
+constexpr static DP_KEY<N> dp_key(const MIDDLE<N> &hash, const std::size_t k) noexcept {
+    DP_KEY<N> key = {0};
+    for (std::size_t i = k; i < N; ++i) {
+        key[i - k] = hash[i];
+    }
+    return key;
+}
+
+/**
+ * @brief the N digest bytes of the DP with key `key`
+ */
+template<std::size_t N>
+constexpr static MIDDLE<N> dp_hash(const DP_KEY<N> &key, const std::size_t k) noexcept {
+    MIDDLE<N> hash = {0};
+    for (std::size_t i = k; i < N; ++i) {
+        hash[i] = key[i - k];
+    }
+    return hash;
+}
+
+template<std::size_t N>
+constexpr static DP_VALUE<N> dp_value(const DP<N> &dp) noexcept {
+    return DP_VALUE<N>{dp.start, dp.length};
+}
+
+/**
+ * @brief device buffer shared by all work-items, DPs are appended through an atomic cursor
+ * 
+ * The cursor keeps counting past the capacity so the host can tell how many DPs were dropped.
+ * It is followed by the count of walkers restarted by the trail cap in the same batch.
+ */
+template<typename HASH, std::size_t N>
+struct DPBuffer {
+    DP<N> *data = nullptr;
+    uint32_t *cursor = nullptr;             // {DPs appended, trail restarts}, reset before every batch
+    static constexpr std::size_t COUNTERS = 2;
+    std::size_t capacity = 0;
+
+    static DPBuffer allocate(sycl::queue &q, std::size_t capacity) {
+        DPBuffer buffer;
+        buffer.data = malloc_device<DP<N>>(capacity, q);
+        buffer.cursor = malloc_device<uint32_t>(COUNTERS, q);
+        buffer.capacity = capacity;
+        return buffer;
+    }
+
+    void free(sycl::queue &q) const {
+        sycl::free(data, q);
+        sycl::free(cursor, q);
+    }
+
+    void append(const MIDDLE<N> &start, const DP_KEY<N> &key, uint32_t length) const noexcept {
+        sycl::atomic_ref<uint32_t, sycl::memory_order::relaxed, sycl::memory_scope::device> ref(*cursor);
+        const auto i = ref.fetch_add(1);
+        if (i < capacity) {
+            data[i] = DP<N>{start, key, length};
+        }
+    }
+
+    void count_restart() const noexcept {
+        sycl::atomic_ref<uint32_t, sycl::memory_order::relaxed, sycl::memory_scope::device> ref(cursor[1]);
+        ref.fetch_add(1);
+    }
+};
+
+/**
+ * @brief DPs and trail restarts of the walkers of one host thread of the host backend
+ */
+template<std::size_t N>
+struct HostDPs {
+    std::vector<DP<N>> *data;
+    std::size_t *restarts;
+
+    void append(const MIDDLE<N> &start, const DP_KEY<N> &key, uint32_t length) const {
+        data->push_back(DP<N>{start, key, length});
+    }
+
+    void count_restart() const noexcept {
+        ++*restarts;
+    }
+};
+
+template<typename HASH, std::size_t N>
+struct State {
+    uint32_t steps_since_last_dp = 0;
+    HASH_WORDS<HASH> start = {0};               // the first N bytes are the middle of the chain start input
+    HASH_WORDS<HASH> hash = {0};                // the first N bytes are the middle of the next input
+
+    State() = default;
+
+    // the first step hashes the start point of the seed
+    State(uint64_t seed, uint64_t key): start{hash_to_words<HASH>(start_point<N>(key, seed))}, hash{start} {}
+
+    bool is_dp(std::size_t dp_bits) const noexcept {
+        return leading_bits_zero<HASH>(hash, dp_bits);
+    }
+
+    /**
+     * @brief bookkeeping of one step to `next` (DP detection and recording)
+     *
+     * After a DP the walker starts over at a fresh point instead of walking on from the DP: a walker whose chain merged
+     * into a stored one (a DP collision or a Robin Hood) would otherwise retrace the stored walker's later trail for the rest of the run.
+     * @param dps               DPBuffer on a device, HostDPs on the host backend
+     * @param step              steps of the walker up to and including this one
+     */
+    template <typename DPS>
+    void advance(const HASH_WORDS<HASH> &next, const Walk<HASH> &walk, const DPS &dps, std::size_t step) noexcept {
+        hash = next;
+        ++steps_since_last_dp;
+
+        if (is_dp(walk.dp_bits)) {
+            dps.append(
+                point<N>(words_to_middle<HASH, N>(start), walk.last_mask), 
+                dp_key<N>(point<N>(words_to_middle<HASH, N>(hash), walk.last_mask), walk.dp_bits / 8), 
+                steps_since_last_dp
+            );
+            fresh_start(walk, step);
+        } else if (steps_since_last_dp >= walk.max_trail) {
+            restart(walk, step);
+            dps.count_restart();
+        }
+    }
+
+    /**
+     * @brief the next chain starts at the start point of a counter made of this chain's start and the step
+     *
+     * Two walkers only share both if they already walked the same chain, so walkers that merged at a DP part there.
+     */
+    void fresh_start(const Walk<HASH> &walk, std::size_t step) noexcept {
+        uint64_t counter = step;
+        for (std::size_t i = 0; i < CEIL_DIV(N, sizeof(start[0])); ++i) {
+            counter = mix64(counter ^ static_cast<uint64_t>(start[i]));
+        }
+        start = hash_to_words<HASH>(start_point<N>(walk.start_key, counter));
+        hash = start;
+        steps_since_last_dp = 0;
+    }
+
+    /**
+     * @brief abandons a trail stuck without a DP for the start point of a counter made of its start, the point it got stuck at and the step
+     *
+     * The point is part of the counter, so a restart does not take the counter of the fresh_start of a walker that found a DP at the same step.
+     */
+    void restart(const Walk<HASH> &walk, std::size_t step) noexcept {
+        uint64_t counter = step;
+        for (std::size_t i = 0; i < CEIL_DIV(N, sizeof(start[0])); ++i) {
+            counter = mix64(counter ^ static_cast<uint64_t>(start[i]));
+            counter = mix64(counter ^ static_cast<uint64_t>(hash[i]));
+        }
+        start = hash_to_words<HASH>(start_point<N>(walk.start_key, counter));
+        hash = start;
+        steps_since_last_dp = 0;
+    }
+
+};
+
+
+/**
+ * @brief LANES walkers advanced in lockstep by one work-item, each with its own DP detection
+ */
+template<typename HASH, std::size_t N>
+struct Lanes {
+    std::array<State<HASH, N>, LANES> lanes;
+
+    /**
+     * @tparam PAIRED           compute the 64-bit words as Word64Pair
+     * @param step              steps of every lane up to and including this one
+     */
+    template <bool PAIRED = false>
+    void step(const Walk<HASH> &walk, const DPBuffer<HASH, N> &dps, std::size_t step) noexcept {
+        using CALC = std::conditional_t<PAIRED, Word64Pair, typename HASH_WORDS<HASH>::value_type>;
+        std::array<HASH_WORDS<HASH>, LANES> prev;
+        for (std::size_t l = 0; l < LANES; ++l) {
+            prev[l] = lanes[l].hash;
+        }
+        const auto next = compress_message<HASH, LANES, CALC>(walk.message, walk.midstate, prev);
+        for (std::size_t l = 0; l < LANES; ++l) {
+            lanes[l].advance(next[l], walk, dps, step);
+        }
+    }
+};
+
+/**
+ * @brief walker index of lane `lane` of work-item `item` (lanes are strided by the work-item count to keep accesses contiguous)
+ */
+constexpr static std::size_t lane_walker(std::size_t item, std::size_t lane, std::size_t threads) noexcept {
+    return lane * (threads / LANES) + item;
+}
+
+template <typename KERNEL>
+class WorkGroupKernel;
+
+/**
+ * @brief runs `body(item, kh)` on work-items 0..items-1, in work-groups of `work_group` work-items (0: of the size the runtime picks)
+ * @pre work_group divides items
+ */
+template <typename KERNEL, typename BODY>
+void parallel_walk(sycl::handler &h, std::size_t items, std::size_t work_group, const BODY &body) {
+    if (work_group == 0) {
+        h.parallel_for<KERNEL>(sycl::range<1>(items), [=](sycl::id<1> item, sycl::kernel_handler kh) {
+            body(item[0], kh);
+        });
+    } else {
+        h.parallel_for<WorkGroupKernel<KERNEL>>(sycl::nd_range<1>(sycl::range<1>(items), sycl::range<1>(work_group)), [=](sycl::nd_item<1> item, sycl::kernel_handler kh) {
+            body(item.get_global_id(0), kh);
+        });
+    }
+}
+
+
+/**
+ * @brief device-only structure-of-arrays storage of the walker states
+ * 
+ * Kernels load a walker into a private State at entry, run the whole batch in registers and store it back once.
+ * Only the digest words that feed the next step (the first N bytes) are kept.
+ * Every walker takes the same number of steps per batch, so the hashes of a device are counted on the host from its batches.
+ */
+template<typename HASH, std::size_t N>
+struct StateBuffers {
+    using word_t = typename HASH_WORDS<HASH>::value_type;
+    constexpr static std::size_t WORDS = CEIL_DIV(N, sizeof(word_t));
+    constexpr static std::size_t BYTES_PER_THREAD = sizeof(uint32_t) + 2 * sizeof(word_t) * WORDS;
+
+    std::size_t threads = 0;
+    uint32_t *steps_since_last_dp = nullptr;
+    word_t *start = nullptr;                // same layout as `hash`
+    word_t *hash = nullptr;                 // word i of walker idx at hash[i * threads + idx]
+
+    static StateBuffers allocate(sycl::queue &q, std::size_t threads) {
+        StateBuffers buffers;
+        buffers.threads = threads;
+        buffers.steps_since_last_dp = malloc_device<uint32_t>(threads, q);
+        buffers.start = malloc_device<word_t>(WORDS * threads, q);
+        buffers.hash = malloc_device<word_t>(WORDS * threads, q);
+        return buffers;
+    }
+
+    /**
+     * @brief host-side copy the kernels can write to directly (for checkpoint snapshots)
+     */
+    static StateBuffers allocate_host(sycl::queue &q, std::size_t threads) {
+        StateBuffers buffers;
+        buffers.threads = threads;
+        buffers.steps_since_last_dp = malloc_host<uint32_t>(threads, q);
+        buffers.start = malloc_host<word_t>(WORDS * threads, q);
+        buffers.hash = malloc_host<word_t>(WORDS * threads, q);
+        return buffers;
+    }
+
+    /**
+     * @brief the three arrays and their sizes in bytes
+     */
+    std::array<std::pair<void *, std::size_t>, 3> arrays() const noexcept {
+        return {{
+            {steps_since_last_dp, sizeof(uint32_t) * threads},
+            {start, sizeof(word_t) * WORDS * threads},
+            {hash, sizeof(word_t) * WORDS * threads}
+        }};
+    }
+
+    void free(sycl::queue &q) const {
+        sycl::free(steps_since_last_dp, q);
+        sycl::free(start, q);
+        sycl::free(hash, q);
+    }
+
+    State<HASH, N> load(std::size_t idx) const noexcept {
+        State<HASH, N> state;
+        state.steps_since_last_dp = steps_since_last_dp[idx];
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            state.start[i] = start[i * threads + idx];
+            state.hash[i] = hash[i * threads + idx];
+        }
+        return state;
+    }
+
+    void store(std::size_t idx, const State<HASH, N> &state) const noexcept {
+        steps_since_last_dp[idx] = state.steps_since_last_dp;
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            start[i * threads + idx] = state.start[i];
+            hash[i * threads + idx] = state.hash[i];
+        }
+    }
+};
+
+
+template <typename HASH, std::size_t N>
+struct StageOneResult {
+    std::size_t x_steps = 0;
+    std::size_t y_steps = 0;
+    std::size_t total_hash_counts = 0;
+    MIDDLE<N> x;
+    MIDDLE<N> y;
+    MIDDLE<N> dp_collided;                  // the first N digest bytes of the DP
+    bool found = false;
+};
+
+template<typename HASH, std::size_t N>
+using WALK_HASH = std::conditional_t<TRUNCATE, Truncated<HASH, N>, HASH>;
@@ -0,0 +1,94 @@
+/**
+ * @file worker_pool.hpp
+ * @author Steven
+ * @brief A fixed-size pool of host worker threads that run one task per worker and wait for all of them (used for the sharded host DP merge)
+ * @version 0.1
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+
+public:
+
+    explicit WorkerPool(std::size_t worker_count) {
+        threads.reserve(worker_count);
+        for (std::size_t i = 0; i < worker_count; ++i) {
+            threads.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        start_cv.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    std::size_t size() const noexcept {
+        return threads.size();
+    }
+
+    /**
+     * @brief runs `task(i)` on every worker i and returns once all of them have finished
+     */
+    void run(const std::function<void(std::size_t)> &task) {
+        std::unique_lock lock(mutex);
+        current = &task;
+        pending = threads.size();
+        ++generation;
+        start_cv.notify_all();
+        done_cv.wait(lock, [this] { return pending == 0; });
+        current = nullptr;
+    }
+
+private:
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const std::function<void(std::size_t)> *current = nullptr;
+    std::size_t generation = 0;
+    std::size_t pending = 0;
+    bool stop = false;
+
+    void work(std::size_t i) {
+        std::size_t seen = 0;
+        while (true) {
+            const std::function<void(std::size_t)> *task = nullptr;
+            {
+                std::unique_lock lock(mutex);
+                start_cv.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) {
+                    return;
+                }
+                seen = generation;
+                task = current;
+            }
+            (*task)(i);
+            {
+                std::lock_guard lock(mutex);
+                --pending;
+            }
+            done_cv.notify_one();
+        }
+    }
+
+};